@@ -0,0 +1,87 @@
+#pragma once
+
+//Include Vulkan
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * Shared Vulkan bootstrap library.
+ *
+ * Both executables (VulkanIntro and VulkanTriangle) used to carry their
+ * own copy of the instance creation logic, each with its own calls into
+ * vkEnumerateInstanceExtensionProperties - the loader walks every layer
+ * manifest for that call, which is measurable on cold start, and the
+ * answer cannot change while the process runs. This library enumerates
+ * once, lazily on first use, and caches the result; the extension and
+ * layer name lists are compile-time tables, so no list is ever built at
+ * runtime. Linked as a static library from both CMakeLists.txt files.
+ */
+namespace vkbootstrap {
+
+	/* the validation layers enabled when requested - a compile-time
+	 * table, the single source of truth for both executables
+	 * (implicitly enables a whole range of useful diagnostics layers) */
+	constexpr const char* VALIDATION_LAYERS[] = {
+		"VK_LAYER_LUNARG_standard_validation"
+	};
+	constexpr uint32_t VALIDATION_LAYER_COUNT =
+		sizeof(VALIDATION_LAYERS) / sizeof(VALIDATION_LAYERS[0]);
+
+	/* the instance extensions that go with the validation layers;
+	 * createInstance() appends them automatically */
+	constexpr const char* DEBUG_EXTENSIONS[] = {
+		VK_EXT_DEBUG_UTILS_EXTENSION_NAME
+	};
+	constexpr uint32_t DEBUG_EXTENSION_COUNT =
+		sizeof(DEBUG_EXTENSIONS) / sizeof(DEBUG_EXTENSIONS[0]);
+
+	/**
+	 * The available instance extensions, enumerated once on first use
+	 * and cached for the lifetime of the process
+	 */
+	const std::vector<VkExtensionProperties>& instanceExtensions();
+
+	/**
+	 * The available instance layers - lazy like the extensions, so a
+	 * release build with validation off never pays for the layer walk
+	 */
+	const std::vector<VkLayerProperties>& instanceLayers();
+
+	/* membership tests against the cached enumerations */
+	bool hasInstanceExtension(const char* name);
+	bool hasInstanceLayer(const char* name);
+
+	/* checks that every layer in VALIDATION_LAYERS is available */
+	bool validationLayersSupported();
+
+	/**
+	 * Everything createInstance() needs beyond the compile-time tables
+	 */
+	struct InstanceOptions {
+		/* reported to the driver (may steer application profiles) */
+		const char* applicationName = "Application Name";
+		/* requested Vulkan API version */
+		uint32_t apiVersion = VK_API_VERSION_1_0;
+		/* enables the VALIDATION_LAYERS table plus DEBUG_EXTENSIONS */
+		bool enableValidationLayers = false;
+		/* additional instance extensions, e.g. the surface extensions
+		 * GLFW reports; the debug extensions need not be listed here */
+		std::vector<const char*> extensions;
+		/* chained into VkInstanceCreateInfo::pNext when validation is
+		 * on - e.g. a debug messenger create info so instance creation
+		 * and destruction are covered too */
+		const void* pNext = nullptr;
+	};
+
+	/**
+	 * Creates the instance (connection between app and Vulkan Library).
+	 * Verifies the validation layers against the cached layer list when
+	 * they are requested
+	 * @param options	see InstanceOptions
+	 * @return the created instance (the caller owns it)
+	 */
+	VkInstance createInstance(const InstanceOptions& options);
+
+}
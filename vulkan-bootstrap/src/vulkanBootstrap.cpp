@@ -0,0 +1,114 @@
+#include "vulkanBootstrap.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace vkbootstrap {
+
+const std::vector<VkExtensionProperties>& instanceExtensions() {
+	// enumerated once on first use; the function-local static also makes
+	// the first call thread safe (the triangle application creates its
+	// instance on a worker thread)
+	static std::vector<VkExtensionProperties> extensions = [] {
+		uint32_t extensionCount = 0;
+		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> result(extensionCount);
+		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, result.data());
+		return result;
+	}();
+	return extensions;
+}
+
+const std::vector<VkLayerProperties>& instanceLayers() {
+	static std::vector<VkLayerProperties> layers = [] {
+		uint32_t layerCount = 0;
+		vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+
+		std::vector<VkLayerProperties> result(layerCount);
+		vkEnumerateInstanceLayerProperties(&layerCount, result.data());
+		return result;
+	}();
+	return layers;
+}
+
+bool hasInstanceExtension(const char* name) {
+	for (const auto& extension : instanceExtensions()) {
+		if (strcmp(name, extension.extensionName) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool hasInstanceLayer(const char* name) {
+	for (const auto& layer : instanceLayers()) {
+		if (strcmp(name, layer.layerName) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool validationLayersSupported() {
+	for (uint32_t i = 0; i < VALIDATION_LAYER_COUNT; i++) {
+		if (!hasInstanceLayer(VALIDATION_LAYERS[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+VkInstance createInstance(const InstanceOptions& options) {
+	// the layer walk only happens here, and only when validation is
+	// actually requested
+	if (options.enableValidationLayers && !validationLayersSupported()) {
+		throw std::runtime_error("validation layers requested, but not available!");
+	}
+
+	// Fill a struct with Informationen about Application
+	// (optional), may provide useful informationen to the driver for optimisation
+	VkApplicationInfo appInfo = {};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;	//specify struct Type
+	appInfo.pApplicationName = options.applicationName;
+	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.pEngineName = "No Engine";
+	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.apiVersion = options.apiVersion;
+
+	// (non optional) tells the Vulkan driver which global extension and
+	// validation layers we want to use
+	VkInstanceCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	createInfo.pApplicationInfo = &appInfo;
+
+	// the caller's extensions plus the debug table when validation is on
+	std::vector<const char*> extensions = options.extensions;
+
+	if (options.enableValidationLayers) {
+		for (uint32_t i = 0; i < DEBUG_EXTENSION_COUNT; i++) {
+			extensions.push_back(DEBUG_EXTENSIONS[i]);
+		}
+		// the compile-time tables go straight into the create info - no
+		// list is built at runtime for them
+		createInfo.enabledLayerCount = VALIDATION_LAYER_COUNT;
+		createInfo.ppEnabledLayerNames = VALIDATION_LAYERS;
+		createInfo.pNext = options.pNext;
+	}
+	else {
+		createInfo.enabledLayerCount = 0;
+		createInfo.pNext = nullptr;
+	}
+
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+	createInfo.ppEnabledExtensionNames = extensions.data();
+
+	VkInstance instance = VK_NULL_HANDLE;
+	if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create instance!");
+	}
+
+	return instance;
+}
+
+}
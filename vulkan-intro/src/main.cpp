@@ -6,6 +6,8 @@
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
 
+#include "vulkanBootstrap.h"
+
 #include <iostream>
 
 int main() {
@@ -14,10 +16,21 @@ int main() {
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 	GLFWwindow* window = glfwCreateWindow(800, 600, "Vulkan window", nullptr, nullptr);
 
-	uint32_t extensionCount = 0;
-	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+	// the bootstrap library enumerates the instance extensions once on
+	// first use and caches the result - the instance creation below
+	// reuses it instead of round-tripping into the loader again
+	std::cout << vkbootstrap::instanceExtensions().size() << " extensions supported" << std::endl;
+
+	// create the instance through the shared bootstrap path (the same
+	// one the triangle application links)
+	vkbootstrap::InstanceOptions options;
+	options.applicationName = "Vulkan window";
 
-	std::cout << extensionCount << " extensions supported" << std::endl;
+	uint32_t glfwExtensionCount = 0;
+	const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	options.extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+
+	VkInstance instance = vkbootstrap::createInstance(options);
 
 	glm::mat4 matrix(1.0f);
 	glm::vec4 vec(1.0f);
@@ -27,9 +40,11 @@ int main() {
 		glfwPollEvents();
 	}
 
+	vkDestroyInstance(instance, nullptr);
+
 	glfwDestroyWindow(window);
 
 	glfwTerminate();
 
 	return 0;
-}
\ No newline at end of file
+}
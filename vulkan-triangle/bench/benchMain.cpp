@@ -0,0 +1,152 @@
+#include "TriangleApplication.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+
+/**
+ * Micro-benchmark harness for the Vulkan hot paths.
+ *
+ * Drives TriangleApplication through fixed-frame-count scenarios and
+ * prints one JSON object per scenario (one JSON array in total), so CI
+ * can pin the numbers against every change:
+ *  - frames/sec over the frame loop
+ *  - CPU submission time (vkQueueSubmit p50/p95 from the frame stats)
+ *  - recreateSwapChain() latency (forced every 256 frames, windowed)
+ *  - init-to-first-frame time
+ *
+ * Usage: VulkanTriangleBench [--frames N] [--offscreen-only] [--windowed-only]
+ * The offscreen scenario needs no display, so it is the one to run on
+ * headless CI nodes.
+ */
+
+struct ScenarioResult {
+	std::string name;
+	uint64_t frames = 0;
+	double fps = 0.0;
+	double frameP50Ms = 0.0;
+	double frameP95Ms = 0.0;
+	double submitP50Ms = 0.0;
+	double submitP95Ms = 0.0;
+	double gpuP50Ms = 0.0;
+	double initToFirstFrameMs = 0.0;
+	double recreateAvgMs = 0.0;
+	uint32_t recreateCount = 0;
+};
+
+static ScenarioResult runScenario(const std::string& name, bool offscreen,
+		uint32_t frames, uint32_t recreateEvery) {
+	TriangleApplication app;
+
+	// stdout belongs to the JSON report - no CSV interleaving
+	app.setStatsCsvDump(false);
+	// no shader watcher thread during measurement runs
+	app.hotReloadShaders = false;
+
+	if (offscreen) {
+		app.headless = true;
+		app.headlessFrameCount = frames;
+	}
+	else {
+		app.frameLimit = frames;
+		// measure uncapped CPU/GPU throughput, not the display's refresh
+		app.setPresentPolicy(PresentPolicy::UNCAPPED);
+		// the governor deliberately sleeps - that is the opposite of what
+		// a throughput benchmark wants
+		app.latencyGovernor = false;
+		app.benchRecreateEvery = recreateEvery;
+	}
+
+	app.run();
+
+	ScenarioResult result;
+	result.name = name;
+	result.frames = app.getFramesRendered();
+	if (app.getFrameLoopMs() > 0.0) {
+		result.fps = result.frames / (app.getFrameLoopMs() / 1000.0);
+	}
+	result.frameP50Ms = app.getFrameStats().percentile(FrameStats::PHASE_FRAME, 0.50);
+	result.frameP95Ms = app.getFrameStats().percentile(FrameStats::PHASE_FRAME, 0.95);
+	result.submitP50Ms = app.getFrameStats().percentile(FrameStats::PHASE_SUBMIT, 0.50);
+	result.submitP95Ms = app.getFrameStats().percentile(FrameStats::PHASE_SUBMIT, 0.95);
+	result.gpuP50Ms = app.getFrameStats().percentile(FrameStats::PHASE_GPU, 0.50);
+	result.initToFirstFrameMs = app.getInitToFirstFrameMs();
+	result.recreateCount = app.getRecreateCount();
+	if (result.recreateCount > 0) {
+		result.recreateAvgMs = app.getRecreateTotalMs() / result.recreateCount;
+	}
+
+	return result;
+}
+
+static void printResult(const ScenarioResult& result) {
+	std::cout << "{"
+		<< "\"scenario\":\"" << result.name << "\","
+		<< "\"frames\":" << result.frames << ","
+		<< "\"fps\":" << result.fps << ","
+		<< "\"frame_p50_ms\":" << result.frameP50Ms << ","
+		<< "\"frame_p95_ms\":" << result.frameP95Ms << ","
+		<< "\"submit_p50_ms\":" << result.submitP50Ms << ","
+		<< "\"submit_p95_ms\":" << result.submitP95Ms << ","
+		<< "\"gpu_p50_ms\":" << result.gpuP50Ms << ","
+		<< "\"init_to_first_frame_ms\":" << result.initToFirstFrameMs << ","
+		<< "\"recreate_avg_ms\":" << result.recreateAvgMs << ","
+		<< "\"recreate_count\":" << result.recreateCount
+		<< "}";
+}
+
+int main(int argc, char* argv[]) {
+	uint32_t frames = 1000;
+	bool runWindowed = true;
+	bool runOffscreen = true;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frames = static_cast<uint32_t>(atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--offscreen-only") == 0) {
+			runWindowed = false;
+		}
+		else if (strcmp(argv[i], "--windowed-only") == 0) {
+			runOffscreen = false;
+		}
+		else {
+			std::cerr << "usage: " << argv[0]
+				<< " [--frames N] [--offscreen-only] [--windowed-only]" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	try {
+		std::vector<ScenarioResult> results;
+
+		// offscreen first: it needs no display and fails early on broken
+		// machines before a window ever opens
+		if (runOffscreen) {
+			results.push_back(runScenario("offscreen", true, frames, 0));
+		}
+		if (runWindowed) {
+			results.push_back(runScenario("windowed", false, frames, 256));
+		}
+
+		// the report goes out in one piece after all runs - the scenarios
+		// themselves print shutdown summaries (allocator statistics etc.),
+		// so consumers take the last line of stdout
+		std::cout << "[";
+		for (size_t i = 0; i < results.size(); i++) {
+			if (i != 0) {
+				std::cout << ",";
+			}
+			printResult(results[i]);
+		}
+		std::cout << "]" << std::endl;
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
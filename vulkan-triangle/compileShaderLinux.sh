@@ -1,4 +1,5 @@
 # Change Path to Vulkan Install Path
 # Make the script executable with chmod +x compile.sh and run it.
 /home/user/VulkanSDK/x.x.x.x/x86_64/bin/glslc shader.vert -o vert.spv
-/home/user/VulkanSDK/x.x.x.x/x86_64/bin/glslc shader.frag -o frag.spv
\ No newline at end of file
+/home/user/VulkanSDK/x.x.x.x/x86_64/bin/glslc shader.frag -o frag.spv
+/home/user/VulkanSDK/x.x.x.x/x86_64/bin/glslc shader/cull.comp -o shadercomp/cull.spv
@@ -1,38 +1,45 @@
 #version 450
-// Enable Vulkan GLSL 
+// Enable Vulkan GLSL
 #extension GL_KHR_vulkan_glsl: enable
 #extension GL_ARB_separate_shader_objects : enable
 
 //////////////////
-/// Data Transport 
+/// Data Transport
 //////////////////
 
-layout(location = 0) out vec3 fragColor;
+// per-frame data from the uniform ring buffer (dynamic offset selects the slice)
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 model;
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+// tiny per-draw data, recorded straight into the command buffer
+layout(push_constant) uniform PushConstantData {
+	vec4 tint;
+} push;
 
-//////////////
-/// Data
-//////////////
+// per-vertex attributes fed from the vertex buffer
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
 
-// Vertex Positions NDC
-vec2 positions[3] = vec2[](
-	vec2(0.0, -0.5),
-	vec2(0.5, 0.5),
-	vec2(-0.5, 0.5)
-);
+// per-instance attributes (structure of arrays, bindings 1 and 2)
+// transform packs offset.xy, scale and rotation into one vec4
+layout(location = 2) in vec4 inInstanceTransform;
+layout(location = 3) in vec3 inInstanceColor;
 
-// Vertex Colors
-vec3 colors[3] = vec3[](
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+layout(location = 0) out vec3 fragColor;
 
 //////////////////
 /// Main Function
 //////////////////
 
 void main() {
-	// built-in gl_VertexIndex contains the index of the current Vertex
-	gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-	fragColor = colors[gl_VertexIndex];
-}
\ No newline at end of file
+	// unpack the instance transform: rotate, scale, then offset
+	float c = cos(inInstanceTransform.w);
+	float s = sin(inInstanceTransform.w);
+	vec2 pos = mat2(c, s, -s, c) * inPosition * inInstanceTransform.z + inInstanceTransform.xy;
+
+	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(pos, 0.0, 1.0);
+	fragColor = inColor * inInstanceColor * push.tint.rgb;
+}
@@ -1,57 +1,53 @@
+// stb_image implementation lives in this translation unit (the streamer
+// header only declares it)
+#define STB_IMAGE_IMPLEMENTATION
 #include "TriangleApplication.h"
 #include "root_directory.h"
-
-#ifdef NDEBUG
-const bool enableValidationLayers = false;
-#else
-const bool enableValidationLayers = true;
-#endif
+// shared instance bootstrap (cached enumeration, compile-time name tables)
+#include "vulkanBootstrap.h"
 
 /* --- Helper --- */
 
-/* implicitly enables a whole range of useful diagnostics layers */
-const std::vector<const char*> validationLayers = {
-	"VK_LAYER_LUNARG_standard_validation"
-};
+/* the validation layers live in the bootstrap library's compile-time
+ * table now; this vector only adapts them for the (deprecated but still
+ * honored) device-level enabledLayerCount below */
+const std::vector<const char*> validationLayers(
+	vkbootstrap::VALIDATION_LAYERS,
+	vkbootstrap::VALIDATION_LAYERS + vkbootstrap::VALIDATION_LAYER_COUNT);
 
 // list of required device extensions
 const std::vector<const char*> deviceExtensions = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME	// Swap Chaine for images
 };
+
+/* geometry of the triangle (was hardcoded in the vertex shader before) */
+const std::vector<Vertex> vertices = {
+	{{ 0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},
+	{{ 0.5f,  0.5f}, {0.0f, 1.0f, 0.0f}},
+	{{-0.5f,  0.5f}, {0.0f, 0.0f, 1.0f}}
+};
+
+/* indices into the vertex buffer (trivial for one triangle, but the indexed
+ * path is what real meshes with shared vertices go through) */
+const std::vector<uint16_t> indices = {
+	0, 1, 2
+};
 /**
- * GLFW Resize Window callback to set class memember flag 
+ * GLFW Resize Window callback (main thread) - queues the event for the
+ * render thread instead of touching its state directly
  */
 static void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
 	auto app = reinterpret_cast<TriangleApplication*>(glfwGetWindowUserPointer(window));
-	app->framebufferResized = true;
+	app->notifyFramebufferResized(width, height);
 }
 
-/// <summary>
-/// Creates a VkShaderModule Object.
-/// </summary>
-/// <param name="device">The device.</param>
-/// <param name="code">The buffer with the bytecode.</param>
-/// <returns></returns>
-VkShaderModule createShaderModule(VkDevice device, const std::vector<char>& code) {
-	VkShaderModuleCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	// size spezified in bytes
-	createInfo.codeSize = code.size();
-	// bytecode pointer is a uint32_t pointer
-	// performing a cast like this, one needs to ensure that the data satisfies the
-	// alignment requirements of uint32_t
-	// Luckily the data is stored in an std::vector where the default allocator already  
-	// ensures that the data satisfies the worst case alignment requirements
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-	// Create a VkShaderModule Object
-	VkShaderModule shaderModule;
-
-	if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create shader module!");
-	}
-
-	return shaderModule;
+/**
+ * Resize callback for the additional windows - queues an event for only
+ * the window that changed (looked up by handle inside the application)
+ */
+static void extraWindowResizeCallback(GLFWwindow* window, int width, int height) {
+	auto app = reinterpret_cast<TriangleApplication*>(glfwGetWindowUserPointer(window));
+	app->notifyWindowResized(window, width, height);
 }
 
 /// <summary>
@@ -126,7 +122,38 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance,
 /* --- Public --- */
 
 void TriangleApplication::run() {
-	initWindow();
+	// reference point for the init-to-first-frame measurement
+	runStart = std::chrono::steady_clock::now();
+
+	// startup is the critical path for tooling that relaunches the binary
+	// constantly, so the three independent costs are overlapped:
+	// - instance + debug messenger creation (driver/loader work)
+	// - SPIR-V prefetch (file IO)
+	// - window creation (compositor round trips; must stay on this thread)
+	if (!headless) {
+		// GLFW must be initialized before the instance job asks it for
+		// the required surface extensions
+		initGlfw();
+	}
+
+	std::future<void> instanceJob = std::async(std::launch::async, [this] {
+		createInstance();
+		setupDebugCallback();
+	});
+	std::future<void> shaderJob = std::async(std::launch::async, [] {
+		Shader::prefetch({ "../shadercomp/vert.spv", "../shadercomp/frag.spv", "../shadercomp/cull.spv" });
+	});
+
+	if (!headless) {
+		initWindow();
+	}
+
+	// everything past this point needs the instance; the shader bytes are
+	// only consumed later in createGraphicsPipeline, but joining here
+	// keeps the threading confined to startup
+	instanceJob.get();
+	shaderJob.get();
+
 	initVulkan();
 	mainLoop();
 	cleanup();
@@ -137,10 +164,13 @@ void TriangleApplication::run() {
 /*
  * Initialize the Window
  */
-void TriangleApplication::initWindow() {
+void TriangleApplication::initGlfw() {
 	// Initialize GLFW library
 	glfwInit();
-	// Not create an OpenGL context 
+}
+
+void TriangleApplication::initWindow() {
+	// Not create an OpenGL context
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 	// Disable window Resizing
 	//glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
@@ -151,34 +181,134 @@ void TriangleApplication::initWindow() {
 	glfwSetWindowUserPointer(window, this);
 	// set up resize callback
 	glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+	// seed the cached framebuffer size while this is still the only
+	// thread; from here on the render thread reads the cache and only
+	// the resize events update it
+	glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+
+	// the additional windows (windowCount > 1) share all Vulkan state -
+	// only the GLFW window and its resize callback are per window here,
+	// the rest follows in createExtraWindowResources
+	if (windowCount > 1) {
+		extraWindows.resize(windowCount - 1);
+		for (WindowContext& ctx : extraWindows) {
+			ctx.window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
+			glfwSetWindowUserPointer(ctx.window, this);
+			glfwSetFramebufferSizeCallback(ctx.window, extraWindowResizeCallback);
+			glfwGetFramebufferSize(ctx.window, &ctx.framebufferWidth, &ctx.framebufferHeight);
+		}
+	}
+}
+
+void TriangleApplication::notifyFramebufferResized(int width, int height) {
+	WindowEventQueue::Event event;
+	event.type = WindowEventQueue::Type::FRAMEBUFFER_RESIZED;
+	event.windowIndex = 0;
+	event.width = width;
+	event.height = height;
+	windowEvents.push(event);
+}
+
+void TriangleApplication::notifyWindowResized(GLFWwindow* handle, int width, int height) {
+	for (uint32_t i = 0; i < extraWindows.size(); i++) {
+		if (extraWindows[i].window == handle) {
+			WindowEventQueue::Event event;
+			event.type = WindowEventQueue::Type::FRAMEBUFFER_RESIZED;
+			event.windowIndex = i + 1;
+			event.width = width;
+			event.height = height;
+			windowEvents.push(event);
+			return;
+		}
+	}
 }
 
 /*
  * Initialize Vulkan
  */
 void TriangleApplication::initVulkan() {
-	// create instance (connection between app and Vulkan Library)
-	createInstance();
-	setupDebugCallback();
-	createSurface();
+	// the instance and debug messenger were already created on a worker
+	// thread in run(); this continues from the surface
+	if (!headless) {
+		createSurface();
+	}
 	pickPhysicalDevice();
+	// MSAA runs at the highest sample count the picked device supports
+	// for both color and depth attachments
+	if (msaa) {
+		msaaSamples = getMaxUsableSampleCount();
+	}
 	// create logical device to interface with it
 	createLogicalDevice();
-	// create swap chain
-	createSwapChain();
+	// set up the memory pool allocator (images and buffers draw from it)
+	bufferAllocator.init(physicalDevice, device, MAX_FRAMES_IN_FLIGHT, memoryBudgetAvailable);
+	// deferred destruction keyed to the frame boundary waits (no mid-run stalls)
+	frameGarbage.init(device, &bufferAllocator, MAX_FRAMES_IN_FLIGHT);
+	// descriptor infrastructure: layout dedup cache + pooled set arenas
+	descriptorLayoutCache.init(device);
+	descriptorAllocator.init(device, MAX_FRAMES_IN_FLIGHT);
+	// create swap chain (or the offscreen image ring in headless mode)
+	if (headless) {
+		createOffscreenTarget();
+	}
+	else {
+		createSwapChain();
+	}
 	createImageViews();
+	// the multisampled color target the scene is rendered into (the swap
+	// chain image only receives the in-pass resolve)
+	createColorResources();
+	// depth attachment (early-Z needs it before render pass and framebuffers)
+	createDepthResources();
 	// create a render pass object
 	createRenderPass();
+	// create the pipeline cache (primed from disk) before any pipeline is built
+	createPipelineCache();
+	// layout of the per-frame uniform binding (the pipeline layout needs it)
+	createDescriptorSetLayout();
 	// create draphic pipeline for rendering with Vulkan
 	createGraphicsPipeline();
 	// create Framebuffer object
 	createFramebuffers();
 	// create command pool object
 	createCommandPool();
+	// background texture loading (IO thread, transfer queue uploads)
+	{
+		QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+		textureStreamer.init(physicalDevice, device, &bufferAllocator,
+			transferQueue, indices.transferFamily.value_or(indices.graphicsFamily.value()),
+			graphicsQueue, indices.graphicsFamily.value(),
+			&transferTimeline, &graphicsTimeline,
+			textureBudgetBytes);
+	}
+	// upload the geometry
+	createVertexBuffer();
+	createIndexBuffer();
+	// uniform ring and the descriptor set pointing at it
+	createUniformBuffer();
+	createDescriptorSets();
+	// per-frame instance attribute buffers
+	createInstanceBuffers();
+	// GPU-driven path: culling compute pipeline and indirect draw buffer
+	if (gpuCulling) {
+		createCullResources();
+	}
+	// create timestamp query pool (before the command buffers that write into it)
+	createTimestampQueryPool();
 	// create command Buffers
 	createCommandBuffers();
 	// create semaphores
 	createSyncObjects();
+	// additional windows: surfaces, swap chains and per-frame objects
+	// (needs the shared render pass, pipeline and command pools above)
+	if (!headless && !extraWindows.empty()) {
+		createExtraWindowResources();
+	}
+	// shader hot reload: watch the shader files and rebuild the pipeline
+	// in the background when they change
+	if (hotReloadShaders) {
+		initShaderHotReload();
+	}
 }
 
 void TriangleApplication::createImageViews()
@@ -215,6 +345,151 @@ void TriangleApplication::createImageViews()
 	}
 }
 
+VkFormat TriangleApplication::findDepthFormat()
+{
+	// depth-only float format first: reversed-Z needs the float
+	// distribution, and skipping the stencil bits saves bandwidth
+	const VkFormat candidates[] = {
+		VK_FORMAT_D32_SFLOAT,
+		VK_FORMAT_D32_SFLOAT_S8_UINT,
+		VK_FORMAT_D24_UNORM_S8_UINT
+	};
+
+	for (VkFormat format : candidates) {
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+		if (props.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+			return format;
+		}
+	}
+
+	throw std::runtime_error("failed to find supported depth format!");
+}
+
+void TriangleApplication::createColorResources()
+{
+	// single-sampled rendering goes straight into the swap chain image -
+	// no separate color target needed
+	if (msaaSamples == VK_SAMPLE_COUNT_1_BIT) {
+		return;
+	}
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = swapChainExtent.width;
+	imageInfo.extent.height = swapChainExtent.height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = 1;	// MSAA images never have mip chains
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = swapChainImageFormat;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	// the samples are written and resolved within one render pass
+	// instance and never read afterwards - transient usage tells
+	// tile-based GPUs the image can stay on chip
+	imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	imageInfo.samples = msaaSamples;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateImage(device, &imageInfo, nullptr, &colorImage) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create color image!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, colorImage, &memRequirements);
+
+	// prefer lazily allocated memory: for a transient attachment a tiler
+	// never commits the backing store at all. Desktop GPUs usually have
+	// no such memory type - plain device local is the fallback
+	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	if (bufferAllocator.hasMemoryType(memRequirements.memoryTypeBits,
+			properties | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+		properties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	}
+
+	colorImageAllocation = bufferAllocator.allocate(memRequirements, properties, false);
+	vkBindImageMemory(device, colorImage, colorImageAllocation.memory, colorImageAllocation.offset);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = colorImage;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = swapChainImageFormat;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(device, &viewInfo, nullptr, &colorImageView) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create color image view!");
+	}
+}
+
+void TriangleApplication::createDepthResources()
+{
+	depthFormat = findDepthFormat();
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = swapChainExtent.width;
+	imageInfo.extent.height = swapChainExtent.height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = depthFormat;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	// the render pass transitions from UNDEFINED itself - the previous
+	// content is cleared anyway
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	// the depth attachment has to match the color sample count; it is
+	// cleared, tested and thrown away within one render pass instance
+	// (store op DONT_CARE), so when multisampled it qualifies as a
+	// transient attachment like the color target
+	imageInfo.samples = msaaSamples;
+	if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+		imageInfo.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	}
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateImage(device, &imageInfo, nullptr, &depthImage) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth image!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, depthImage, &memRequirements);
+
+	// same lazy-memory preference as the color target (see
+	// createColorResources)
+	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	if (msaaSamples != VK_SAMPLE_COUNT_1_BIT &&
+		bufferAllocator.hasMemoryType(memRequirements.memoryTypeBits,
+			properties | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+		properties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	}
+
+	depthImageAllocation = bufferAllocator.allocate(memRequirements, properties, false);
+	vkBindImageMemory(device, depthImage, depthImageAllocation.memory, depthImageAllocation.offset);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = depthImage;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = depthFormat;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(device, &viewInfo, nullptr, &depthImageView) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth image view!");
+	}
+}
+
 void TriangleApplication::createSwapChain()
 {
 	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
@@ -223,17 +498,9 @@ void TriangleApplication::createSwapChain()
 	VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
 	VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-	// number of images to have in swap chain
-	// using the minimum number plus one to avoid wainting on the driver to complete
-	// internal operations vefore acquiring another image to render
-	uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-
-	// make sure to not exceed the maximum number of images
-	// 0 is a special value, that means that there is no maximum
-	if (swapChainSupport.capabilities.maxImageCount > 0 && 
-		imageCount > swapChainSupport.capabilities.maxImageCount) {
-		imageCount = swapChainSupport.capabilities.maxImageCount;
-	}
+	// number of images to have in swap chain - tuned per present policy
+	// (mailbox needs headroom to drop frames into, FIFO takes the minimum)
+	uint32_t imageCount = chooseSwapImageCount(swapChainSupport.capabilities, presentMode);
 
 	VkSwapchainCreateInfoKHR createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -284,11 +551,16 @@ void TriangleApplication::createSwapChain()
 	// for example because another window is in front of them (better performance, unless the necessarity
 	// to be able to reade these pixels back and get predictable results is needed)
 
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	// hand the driver the retiring swap chain so it can recycle its images
+	// and keep presenting from it until the new one is ready - this is what
+	// makes recreation incremental instead of a full teardown
+	createInfo.oldSwapchain = swapChain;
 
-	if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
+	VkSwapchainKHR newSwapChain;
+	if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &newSwapChain) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create swap chain!");
 	}
+	swapChain = newSwapChain;
 
 	// query final number of images
 	vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
@@ -303,6 +575,46 @@ void TriangleApplication::createSwapChain()
 
 }
 
+void TriangleApplication::createOffscreenTarget()
+{
+	// same triple-buffering depth a typical swap chain ends up with
+	const size_t imageCount = MAX_FRAMES_IN_FLIGHT + 1;
+
+	swapChainImages.resize(imageCount);
+	offscreenImageAllocations.resize(imageCount);
+	// fill in the members the rest of the renderer reads
+	swapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+	swapChainExtent = { static_cast<uint32_t>(WIDTH), static_cast<uint32_t>(HEIGHT) };
+
+	for (size_t i = 0; i < imageCount; i++) {
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = swapChainExtent.width;
+		imageInfo.extent.height = swapChainExtent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = swapChainImageFormat;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		// rendered into and copied out for readback
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateImage(device, &imageInfo, nullptr, &swapChainImages[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create offscreen image!");
+		}
+
+		VkMemoryRequirements memRequirements;
+		vkGetImageMemoryRequirements(device, swapChainImages[i], &memRequirements);
+
+		offscreenImageAllocations[i] = bufferAllocator.allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
+		vkBindImageMemory(device, swapChainImages[i], offscreenImageAllocations[i].memory, offscreenImageAllocations[i].offset);
+	}
+}
+
 /*
  * Creates an abstract Surface
  */
@@ -330,34 +642,104 @@ void TriangleApplication::pickPhysicalDevice() {
 	std::vector<VkPhysicalDevice> devices(deviceCount);
 	vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
-	// Check devices for meeting requirements 
-	for (const auto& device : devices) {
-		if (isDeviceSuitable(device)) {
-			physicalDevice = device;
-			break;
+	// fast path: if a previous run cached its winning device and that
+	// device is still present and suitable, take it without scoring the
+	// whole system again (startup latency matters for batch rendering)
+	CachedDeviceIdentity cached;
+	if (readCachedDeviceIdentity(cached)) {
+		for (const auto& device : devices) {
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(device, &properties);
+
+			if (properties.vendorID == cached.vendorID &&
+				properties.deviceID == cached.deviceID &&
+				memcmp(properties.pipelineCacheUUID, cached.uuid, VK_UUID_SIZE) == 0 &&
+				isDeviceSuitable(device)) {
+				physicalDevice = device;
+				return;
+			}
 		}
-	} 
+		// cached device gone (driver update, GPU swapped) - fall through
+	}
 
-	if (physicalDevice == VK_NULL_HANDLE) {
-		throw std::runtime_error("failed to find a suitable GPU!");
+	// Giving a score to the graphic cards and fall back to the integrated
+	// if it's the only available
+	// Each device is scored on its own thread - the queries behind
+	// rateDeviceSuitability go through the driver per device, so on
+	// multi-GPU systems they overlap instead of serializing
+	std::vector<std::future<int>> scores;
+	scores.reserve(devices.size());
+	for (const auto& device : devices) {
+		scores.push_back(std::async(std::launch::async, [this, device] {
+			return rateDeviceSuitability(device);
+		}));
 	}
 
-	/* Giving a score to the graphic cards and fall back to the integrated if it's the only available */
 	// Use an ordered map to automatically sort candidates by increasing score
-	/*std::multimap<int, VkPhysicalDevice> candidates;
+	std::multimap<int, VkPhysicalDevice> candidates;
 
-	for (const auto& device : devices) {
-		int score = rateDeviceSuitability(device);
-		candidates.insert(std::make_pair(score, device));
+	for (size_t i = 0; i < devices.size(); i++) {
+		candidates.insert(std::make_pair(scores[i].get(), devices[i]));
 	}
 
 	// Check if the best candidate is suitable at all
-	if (candidates.rbegin()->first > 0) {
+	if (!candidates.empty() && candidates.rbegin()->first > 0) {
 		physicalDevice = candidates.rbegin()->second;
 	}
 	else {
 		throw std::runtime_error("failed to find a suitable GPU!");
-	} */
+	}
+
+	// remember the winner for the next startup
+	writeCachedDeviceIdentity(physicalDevice);
+}
+
+VkSampleCountFlagBits TriangleApplication::getMaxUsableSampleCount()
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	// color and depth attachments share the sample count, so only the
+	// counts supported by both are usable
+	VkSampleCountFlags counts = properties.limits.framebufferColorSampleCounts
+		& properties.limits.framebufferDepthSampleCounts;
+
+	if (counts & VK_SAMPLE_COUNT_64_BIT) { return VK_SAMPLE_COUNT_64_BIT; }
+	if (counts & VK_SAMPLE_COUNT_32_BIT) { return VK_SAMPLE_COUNT_32_BIT; }
+	if (counts & VK_SAMPLE_COUNT_16_BIT) { return VK_SAMPLE_COUNT_16_BIT; }
+	if (counts & VK_SAMPLE_COUNT_8_BIT) { return VK_SAMPLE_COUNT_8_BIT; }
+	if (counts & VK_SAMPLE_COUNT_4_BIT) { return VK_SAMPLE_COUNT_4_BIT; }
+	if (counts & VK_SAMPLE_COUNT_2_BIT) { return VK_SAMPLE_COUNT_2_BIT; }
+
+	return VK_SAMPLE_COUNT_1_BIT;
+}
+
+bool TriangleApplication::readCachedDeviceIdentity(CachedDeviceIdentity& identity)
+{
+	std::ifstream file(DEVICE_CACHE_FILE, std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+	file.read(reinterpret_cast<char*>(&identity), sizeof(identity));
+	return file.gcount() == sizeof(identity);
+}
+
+void TriangleApplication::writeCachedDeviceIdentity(VkPhysicalDevice device)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device, &properties);
+
+	CachedDeviceIdentity identity;
+	identity.vendorID = properties.vendorID;
+	identity.deviceID = properties.deviceID;
+	memcpy(identity.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+	std::ofstream file(DEVICE_CACHE_FILE, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		// a read only working directory just means no fast path next time
+		return;
+	}
+	file.write(reinterpret_cast<const char*>(&identity), sizeof(identity));
 }
 
 /*
@@ -370,6 +752,13 @@ void TriangleApplication::createLogicalDevice() {
 	// Create the presentation queue
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+	// also create queues on the dedicated async families if the device has them
+	if (indices.transferFamily.has_value()) {
+		uniqueQueueFamilies.insert(indices.transferFamily.value());
+	}
+	if (indices.computeFamily.has_value()) {
+		uniqueQueueFamilies.insert(indices.computeFamily.value());
+	}
 
 	float queuePriority = 1.0f;
 	for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -393,8 +782,68 @@ void TriangleApplication::createLogicalDevice() {
 	createInfo.pEnabledFeatures = &deviceFeatures;
 
 	//enable same validation layers for devices as for instance
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	// (headless mode runs without the swap chain extension)
+	std::vector<const char*> enabledExtensions;
+	if (!headless) {
+		enabledExtensions = deviceExtensions;
+	}
+
+	// opt into VK_EXT_memory_budget when the driver offers it, so the
+	// allocator can warn against the OS-reported budget instead of the
+	// raw heap size
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+	bool timelineSemaphoresAvailable = false;
+	for (const auto& extension : availableExtensions) {
+		if (strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) {
+			enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+			memoryBudgetAvailable = true;
+		}
+		// push descriptors let hot paths write descriptors straight into
+		// the command buffer, skipping set allocation entirely
+		else if (strcmp(extension.extensionName, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME) == 0) {
+			enabledExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+			pushDescriptorsAvailable = true;
+		}
+		// extended dynamic state: cull mode, front face and depth compare
+		// become record-time state, so pipeline variant families collapse
+		// into a single pipeline object
+		else if (strcmp(extension.extensionName, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME) == 0) {
+			enabledExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+			extendedDynamicStateAvailable = true;
+		}
+		// timeline semaphores carry the whole frame synchronization engine
+		// (see queueTimeline.h) - unlike the opt-ins above they are a hard
+		// requirement, checked right below
+		else if (strcmp(extension.extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0) {
+			enabledExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+			timelineSemaphoresAvailable = true;
+		}
+	}
+
+	if (!timelineSemaphoresAvailable) {
+		throw std::runtime_error("timeline semaphores are not supported by the device!");
+	}
+
+	// the timeline semaphore feature bit needs switching on explicitly
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures{};
+	timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+	createInfo.pNext = &timelineSemaphoreFeatures;
+
+	// same for extended dynamic state (chained behind the timelines)
+	VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+	extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+	extendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
+	if (extendedDynamicStateAvailable) {
+		extendedDynamicStateFeatures.pNext = &timelineSemaphoreFeatures;
+		createInfo.pNext = &extendedDynamicStateFeatures;
+	}
+
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+	createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 	if (enableValidationLayers) {
 		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -423,6 +872,29 @@ void TriangleApplication::createLogicalDevice() {
 	vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
 	// Call to retrieve the queue handle
 	vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+	// async queues; on devices without dedicated families these resolve to
+	// the same underlying queue as the graphics queue, which keeps all the
+	// submission code paths uniform
+	vkGetDeviceQueue(device, indices.transferFamily.value_or(indices.graphicsFamily.value()), 0, &transferQueue);
+	vkGetDeviceQueue(device, indices.computeFamily.value_or(indices.graphicsFamily.value()), 0, &computeQueue);
+
+	// one monotonic timeline per queue drives all CPU-GPU and cross-queue
+	// synchronization; created with the device because everything
+	// downstream (streamer uploads, frame submits) signals against them
+	graphicsTimeline.init(device);
+	transferTimeline.init(device);
+
+	// load the extended dynamic state entry points (device-level functions
+	// of an extension are not part of the statically linked loader API)
+	if (extendedDynamicStateAvailable) {
+		pfnCmdSetCullMode = reinterpret_cast<PFN_vkCmdSetCullModeEXT>(
+			vkGetDeviceProcAddr(device, "vkCmdSetCullModeEXT"));
+		pfnCmdSetFrontFace = reinterpret_cast<PFN_vkCmdSetFrontFaceEXT>(
+			vkGetDeviceProcAddr(device, "vkCmdSetFrontFaceEXT"));
+		pfnCmdSetDepthCompareOp = reinterpret_cast<PFN_vkCmdSetDepthCompareOpEXT>(
+			vkGetDeviceProcAddr(device, "vkCmdSetDepthCompareOpEXT"));
+	}
 }
 
 void TriangleApplication::createCommandPool()
@@ -444,257 +916,1175 @@ void TriangleApplication::createCommandPool()
 	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create command pool!");
 	}
-}
 
-void TriangleApplication::createCommandBuffers()
-{
-	// allocate commandBuffers for each swap chaine image
-	commandBuffers.resize(swapChainFramebuffers.size());
+	// pools for the one-shot buffers submitted on the async queues;
+	// marked transient because those buffers live for a single submit
+	VkCommandPoolCreateInfo asyncPoolInfo{};
+	asyncPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	asyncPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.commandPool = commandPool;
-	// specify if the allocated command buffers are:
-	// VK_COMMAND_BUFFER_LEVEL_PRIMARY: can be submitted to a queue for execution, 
-	//									but cannot be called from other 
-	//									command buffers
-	// VK_COMMAND_BUFFER_LEVEL_SECONDARY: cannot be submitted directly but can be called from primary
-	//									command buffers (it's helpfull to reuse common operations from
-	//									primary command buffers)
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
+	asyncPoolInfo.queueFamilyIndex = queueFamilyIndices.transferFamily.value_or(queueFamilyIndices.graphicsFamily.value());
+	if (vkCreateCommandPool(device, &asyncPoolInfo, nullptr, &transferCommandPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create transfer command pool!");
+	}
 
-	if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate command buffers!");
+	asyncPoolInfo.queueFamilyIndex = queueFamilyIndices.computeFamily.value_or(queueFamilyIndices.graphicsFamily.value());
+	if (vkCreateCommandPool(device, &asyncPoolInfo, nullptr, &computeCommandPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create compute command pool!");
 	}
 
-	// begin recording command buffer 
-	for (size_t i = 0; i < commandBuffers.size(); i++)
-	{
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		// specify how the command buffer should be used
-		// VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT: 
-		//		command buffer will be rerecorded after executing it once
-		// VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT
-		//		secondary command buffer that will be entirely within a single render pass
-		// VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT
-		//		command buffer can be resubmitted while its also already pending execution
-		beginInfo.flags = 0; // Optional
-		// only relevant for secondary command buffers; 
-		// specifies which state to inherit from the calling primary command buffers
-		beginInfo.pInheritanceInfo = nullptr; // Optional
-
-		if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS)
-		{
-			throw std::runtime_error("failed to begin recording command buffers!");
-		}
+	// per-frame pool ring: each frame resets its own pool in bulk and
+	// re-records from scratch, so the pools are marked transient
+	frameCommandPools.resize(MAX_FRAMES_IN_FLIGHT);
 
-		// configure render pass
-		VkRenderPassBeginInfo renderPassInfo{};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		// renderpass itself
-		renderPassInfo.renderPass = renderPass;
-		// attachment to bind
-		renderPassInfo.framebuffer = swapChainFramebuffers[i];
-
-		// define the size of the render area (pixels outside will have undefined values)
-		// best performance when it matches the size of the attachment
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = swapChainExtent;
-
-		//define the clear value to use for VK_ATTACHMENT_LOAD_OP_CLEAR
-		VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };	// Define black with 100% opacity
-		renderPassInfo.clearValueCount = 1;
-		renderPassInfo.pClearValues = &clearColor;
-
-		// begin render pass
-		// the final parameter contols ow the drawing commands will be provided
-		// VK_SUBPASS_CONTENTS_INLINE: will be embedded in the primary command buffer itself and 
-		//								no secondary command will be executed 
-		// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS: will be executed from the secondary 
-		//												command buffers
-		vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-			// bind graphics pipeline
-			// secondary parameter specifies if the pipeline object is a graphics or compute pipeline
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-			// Define Draw function
-			// Parameters:
-			//	Command Buffer
-			//	vertexCount:	3 Vertices to define a triangle
-			//	instanceCount:	1 if no instance rendering should be used
-			//	firstVertex:	offset into the vertex buffer, defines the lowest value of gl_VertexIndex
-			//	firstInstance:	offset for instanced rendering, defines the lowest value fo gl_InstanceIndex
-			vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
-		// end the render pass
-		vkCmdEndRenderPass(commandBuffers[i]);
+	VkCommandPoolCreateInfo framePoolInfo{};
+	framePoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	framePoolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+	framePoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
-		// finishe recording the command buffers
-		if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-			throw std::runtime_error("failed to record command buffer!");
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		if (vkCreateCommandPool(device, &framePoolInfo, nullptr, &frameCommandPools[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create frame command pool!");
 		}
 	}
+
+	// start the recording workers (their per-thread pools live on the
+	// graphics family, as the secondaries are executed by the primary there)
+	recordingWorkers.init(device, queueFamilyIndices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT);
 }
 
-void TriangleApplication::drawFrame()
+VkCommandBuffer TriangleApplication::beginSingleTimeCommands(VkCommandPool pool)
 {
-	// wait here for the frame to be finished
-	// last parameter is the time out, the previous parameter indicates to wait for all fences
-	vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
-	
-	// aquiring an image from the swap chain
-	// ------------------------------------
-	uint32_t imageIndex;
-	// parameters:
-	//	device - logical device
-	//	swapChain - swap chain from which the image should be acquired
-	//	timeout - timeout in nanoseconds for an image to become available (UINT64_MAX disables the timeout)
-	//	synchronication object (semaphore) - to be signaled when the presentation engine is finished
-	//  synchronication object (fence) - to be signaled when the presentation engine is finished
-	//	index - index of the swap chain image in the swapChainImages Array
-	VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphore[currentFrame], VK_NULL_HANDLE, &imageIndex);
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = pool;
+	allocInfo.commandBufferCount = 1;
 
-	// check if swap chain needs to be recreated
-	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-		// VK_ERROR_OUT_OF_DATE_KHR -  The swap chain has become incompatible with the surface and can no longer be used for rendering. 
-		// Usually happens after a window resize.
-		recreateSwapChain();
-		return;
-	}
-	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-		//  VK_SUBOPTIMAL_KHR - The swap chain can still be used to successfully present to the surface, 
-		// but the surface properties are no longer matched exactly.
-		throw std::runtime_error("failed to acquire swap chain image!");
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate one-shot command buffer!");
 	}
 
-	// Check if a previous frame is using this image (i.e. there is its fence to wait on)
-	if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
-		vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	// the buffer is used exactly once and then freed
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	return commandBuffer;
+}
+
+void TriangleApplication::endSingleTimeCommands(VkCommandBuffer commandBuffer, VkQueue queue, VkCommandPool pool)
+{
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record one-shot command buffer!");
 	}
-	// Mark the image as now being in use by this frame
-	imagesInFlight[imageIndex] = inFlightFences[currentFrame];
 
-	// submitting the command buffer
-	// -----------------------------
-	// Queue submission and synchronization configuration
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	
-	// specify which semaphores to wait on before execution begins
-	VkSemaphore waitSemaphores[] = { imageAvailableSemaphore[currentFrame] };
-	// specify which stages of the pipeline to wait
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };	// Stage: Writing colors to image buffer
-	submitInfo.waitSemaphoreCount = 1;
-	// each entry in the wait Stages array corresponds to the semaphore with the same index in pWaitEmaphores
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
-
-	// specify command buffers to actually submit for execution
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+	submitInfo.pCommandBuffers = &commandBuffer;
 
-	// specify which semaphores to signale once the command buffers(s) have finish execution
-	VkSemaphore signalSemaphores[] = { renderFinishedSemaphore[currentFrame] };
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores;
+	// wait with a fence instead of vkQueueWaitIdle, so a busy shared queue
+	// (no dedicated family) does not stall longer than necessary
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 
-	// manually restore fence to the unsignaled state
-	vkResetFences(device, 1, &inFlightFences[currentFrame]);
+	VkFence fence;
+	if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create one-shot submit fence!");
+	}
 
-	// submit the command buffer to the graphics queue
-	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-		throw std::runtime_error("failed to submit draw command buffer!");
+	if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+		vkDestroyFence(device, fence, nullptr);
+		throw std::runtime_error("failed to submit one-shot command buffer!");
 	}
 
-	// Presentation
-	// ------------
-	// submitting the result back to the swap chain to have it show up on the screen
+	vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
 
-	VkPresentInfoKHR presentInfo{};
-	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	vkDestroyFence(device, fence, nullptr);
+	vkFreeCommandBuffers(device, pool, 1, &commandBuffer);
+}
 
-	// specify which semaphores ot wait on before presentation
-	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
+void TriangleApplication::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+{
+	// record the copy on the transfer queue - on hardware with a dedicated
+	// transfer family this runs on the DMA engine while rendering continues
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands(transferCommandPool);
 
-	// specify the swap chains to present images to and the index of the image for each swap chain 
-	VkSwapchainKHR swapChains[] = { swapChain };
-	presentInfo.swapchainCount = 1;
-	presentInfo.pSwapchains = swapChains;
-	presentInfo.pImageIndices = &imageIndex;
-	
-	// specify an array of VkResult values  to check for every individual swap chain if presentation was successfull 
-	presentInfo.pResults = nullptr; // Optional, when using just one swap chain
-	// submit the request to present an image to the swap chain
-	result = vkQueuePresentKHR(presentQueue, &presentInfo);
+	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = 0;	// Optional
+	copyRegion.dstOffset = 0;	// Optional
+	copyRegion.size = size;
+	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
-		framebufferResized = false;
-		recreateSwapChain();
+	endSingleTimeCommands(commandBuffer, transferQueue, transferCommandPool);
+}
+
+void TriangleApplication::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+	VkBuffer& buffer, BufferAllocator::Allocation& allocation)
+{
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+
+	// when graphics and transfer run on different families the buffer is
+	// used by both (copy on transfer, draw on graphics) - share it
+	// concurrently, same pattern as the swap chain images
+	QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+	uint32_t families[] = {
+		queueFamilyIndices.graphicsFamily.value(),
+		queueFamilyIndices.transferFamily.value_or(queueFamilyIndices.graphicsFamily.value())
+	};
+
+	if (families[0] != families[1]) {
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = 2;
+		bufferInfo.pQueueFamilyIndices = families;
 	}
-	else if (result != VK_SUCCESS) {
-		throw std::runtime_error("failed to present swap chain image!");
+	else {
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	}
 
-	// advance current frame to the next
-	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
-}
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create buffer!");
+	}
 
-int TriangleApplication::rateDeviceSuitability(VkPhysicalDevice device) {
-	VkPhysicalDeviceProperties deviceProperties;
-	VkPhysicalDeviceFeatures deviceFeatures;
+	// back the buffer with a slice of a pooled memory block
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-	// Querying for name, type, supported Vulkan version
-	vkGetPhysicalDeviceProperties(device, &deviceProperties);
+	allocation = bufferAllocator.allocate(memRequirements, properties, true);
 
-	// Querying for optional features like: texture compression, 64bit floats & multi viewport rendering (for VR)
-	vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+	vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+}
 
-	int score = 0;
+void TriangleApplication::createVertexBuffer()
+{
+	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
 
-	// Discrete GPUs have a significant  performance advantage
-	if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
-		score += 1000;
-	}
+	// staging buffer in host visible memory; the pool allocator keeps its
+	// block persistently mapped, so the data is just memcpy'd in
+	VkBuffer stagingBuffer;
+	BufferAllocator::Allocation stagingAllocation;
+	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stagingBuffer, stagingAllocation);
 
-	// Maximum possible size of textures affects graphics quality
-	score += deviceProperties.limits.maxImageDimension2D;
+	memcpy(stagingAllocation.mapped, vertices.data(), (size_t)bufferSize);
 
-	// Application can't function without geometry shaders
-	if (!deviceFeatures.geometryShader) {
-		return 0;
-	}
+	// the actual vertex buffer lives in device local memory
+	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		vertexBuffer, vertexBufferAllocation);
 
-	return score;
+	// copy on the transfer queue (overlaps rendering on dedicated families)
+	copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	bufferAllocator.free(stagingAllocation);
 }
 
-SwapChainSupportDetails TriangleApplication::querySwapChainSupport(VkPhysicalDevice device)
+void TriangleApplication::createIndexBuffer()
 {
-	SwapChainSupportDetails details;
-
-	// check basic surface capabilites
-	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
+	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
 
-	// querying the supported surface formats
-	uint32_t formatCount;
-	vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
+	VkBuffer stagingBuffer;
+	BufferAllocator::Allocation stagingAllocation;
+	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stagingBuffer, stagingAllocation);
 
-	if (formatCount != 0) {
-		details.formats.resize(formatCount);
-		// make sure that the vector is resized to hold all the available formats
-		vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
-	}
+	memcpy(stagingAllocation.mapped, indices.data(), (size_t)bufferSize);
 
-	// querying the supported presentation modes
-	uint32_t presentModeCount;
-	vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
+	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		indexBuffer, indexBufferAllocation);
 
-	if (presentModeCount != 0) {
-		details.presentModes.resize(presentModeCount);
-		vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
-	}
+	copyBuffer(stagingBuffer, indexBuffer, bufferSize);
 
-	return details;
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	bufferAllocator.free(stagingAllocation);
+}
+
+void TriangleApplication::createDescriptorSetLayout()
+{
+	// one binding: the per-frame uniform data, visible to the vertex stage
+	VkDescriptorSetLayoutBinding uboLayoutBinding{};
+	uboLayoutBinding.binding = 0;
+	// DYNAMIC: the buffer offset is supplied at bind time, so the same
+	// descriptor set addresses every ring slice (and, with many objects,
+	// every object's slice) - one set instead of one per frame/object
+	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	uboLayoutBinding.descriptorCount = 1;
+	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	uboLayoutBinding.pImmutableSamplers = nullptr; // Optional (image sampling)
+
+	// from the cache: any other pipeline asking for the same binding list
+	// gets this very handle back
+	descriptorSetLayout = descriptorLayoutCache.getLayout({ uboLayoutBinding });
+}
+
+void TriangleApplication::createUniformBuffer()
+{
+	// each ring slice must start at a legal dynamic offset, so round the
+	// struct size up to the device's minUniformBufferOffsetAlignment
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+	uniformStride = (sizeof(UniformBufferObject) + alignment - 1) & ~(alignment - 1);
+
+	// one buffer holding all slices; host visible and coherent, so the
+	// persistent mapping from the allocator is all that is ever needed -
+	// no vkMapMemory/vkUnmapMemory or explicit flush per frame
+	createBuffer(uniformStride * MAX_FRAMES_IN_FLIGHT,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		uniformBuffer, uniformBufferAllocation);
+}
+
+void TriangleApplication::createDescriptorSets()
+{
+	// the set lives as long as the renderer - persistent arena
+	descriptorSet = descriptorAllocator.allocate(descriptorSetLayout);
+
+	// point the descriptor at the ring buffer; range covers one slice,
+	// the dynamic offset at bind time selects which one
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = uniformBuffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = sizeof(UniformBufferObject);
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = descriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+}
+
+void TriangleApplication::updateUniformBuffer(uint32_t frame)
+{
+	// time since application start, for a simple rotation that proves the
+	// per-frame data path end to end
+	static auto startTime = std::chrono::high_resolution_clock::now();
+	auto currentTime = std::chrono::high_resolution_clock::now();
+	float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+
+	UniformBufferObject ubo{};
+	ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	ubo.view = glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+	// reversed-Z swaps the near and far planes, so the near plane lands at
+	// depth 1 and the far plane at 0 - together with the GREATER compare
+	// and the 0.0 clear this puts the dense part of the float depth range
+	// on the distant geometry
+	float aspect = swapChainExtent.width / (float)swapChainExtent.height;
+	ubo.proj = reversedZ
+		? glm::perspective(glm::radians(45.0f), aspect, 10.0f, 0.1f)
+		: glm::perspective(glm::radians(45.0f), aspect, 0.1f, 10.0f);
+	// GLM was designed for OpenGL, where the Y coordinate of clip space
+	// is inverted - flip the sign to compensate
+	ubo.proj[1][1] *= -1;
+
+	// only this frame's slice is written; its frame wait has completed,
+	// so the GPU cannot be reading it anymore
+	memcpy(static_cast<char*>(uniformBufferAllocation.mapped) + frame * uniformStride,
+		&ubo, sizeof(ubo));
+}
+
+void TriangleApplication::createInstanceBuffers()
+{
+	// structure of arrays: transforms and colors in separate buffers, so
+	// a shader that ignores one of them never fetches it. Both are rings
+	// with one MAX_INSTANCES slice per frame in flight, persistently
+	// mapped like the uniform ring
+	// STORAGE usage on top of VERTEX: the culling compute shader reads
+	// these as its input arrays
+	createBuffer(sizeof(glm::vec4) * MAX_INSTANCES * MAX_FRAMES_IN_FLIGHT,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		instanceTransformBuffer, instanceTransformAllocation);
+
+	createBuffer(sizeof(glm::vec3) * MAX_INSTANCES * MAX_FRAMES_IN_FLIGHT,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		instanceColorBuffer, instanceColorAllocation);
+}
+
+void TriangleApplication::buildFrameInstances(uint32_t frame)
+{
+	instanceBatcher.clear();
+
+	// the frame's scene: a small grid of triangles, all sharing the same
+	// pipeline and mesh - the batcher collapses them into one instanced
+	// draw. A real scene submits every object here and gets one draw per
+	// (pipeline, mesh) bucket instead of one per object
+	const int gridSize = 4;
+	for (int y = 0; y < gridSize; y++) {
+		for (int x = 0; x < gridSize; x++) {
+			glm::vec2 offset(
+				(x - (gridSize - 1) * 0.5f) * 0.5f,
+				(y - (gridSize - 1) * 0.5f) * 0.5f);
+			float scale = 0.2f;
+			float rotation = 0.0f;
+			glm::vec3 color(
+				(x + 1.0f) / gridSize,
+				(y + 1.0f) / gridSize,
+				1.0f);
+			instanceBatcher.add(graphicsPipeline, 0,
+				glm::vec4(offset, scale, rotation), color);
+		}
+	}
+
+	instanceBatcher.buildBatches();
+
+	if (instanceBatcher.instanceCount() > MAX_INSTANCES) {
+		throw std::runtime_error("instance buffer capacity exceeded!");
+	}
+
+	// upload the SoA data into this frame's slices (plain memcpys - the
+	// buffers are persistently mapped and only touched after the frame's
+	// boundary wait)
+	memcpy(static_cast<char*>(instanceTransformAllocation.mapped) + frame * sizeof(glm::vec4) * MAX_INSTANCES,
+		instanceBatcher.transforms().data(),
+		instanceBatcher.transforms().size() * sizeof(glm::vec4));
+	memcpy(static_cast<char*>(instanceColorAllocation.mapped) + frame * sizeof(glm::vec3) * MAX_INSTANCES,
+		instanceBatcher.colors().data(),
+		instanceBatcher.colors().size() * sizeof(glm::vec3));
+
+	if (gpuCulling) {
+		// reset this frame's indirect command; the culling dispatch bumps
+		// instanceCount for every survivor, everything else is fixed
+		VkDrawIndexedIndirectCommand command{};
+		command.indexCount = static_cast<uint32_t>(indices.size());
+		command.instanceCount = 0;
+		command.firstIndex = 0;
+		command.vertexOffset = 0;
+		command.firstInstance = 0;
+		memcpy(static_cast<char*>(indirectAllocation.mapped) + frame * INDIRECT_SLICE_SIZE,
+			&command, sizeof(command));
+	}
+}
+
+void TriangleApplication::createCullResources()
+{
+	// compacted output buffers, device local - written by the compute
+	// shader, read as instance attributes by the draw; the CPU never maps
+	// them. Sliced per frame in flight like their input counterparts
+	createBuffer(sizeof(glm::vec4) * MAX_INSTANCES * MAX_FRAMES_IN_FLIGHT,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		culledTransformBuffer, culledTransformAllocation);
+
+	createBuffer(sizeof(glm::vec3) * MAX_INSTANCES * MAX_FRAMES_IN_FLIGHT,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		culledColorBuffer, culledColorAllocation);
+
+	// the indirect command buffer; host visible so the per-frame reset is
+	// a memcpy instead of a transfer
+	createBuffer(INDIRECT_SLICE_SIZE * MAX_FRAMES_IN_FLIGHT,
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		indirectBuffer, indirectAllocation);
+
+	// descriptor set layout: five storage buffers (see cull.comp)
+	std::vector<VkDescriptorSetLayoutBinding> bindings(5);
+	for (uint32_t i = 0; i < bindings.size(); i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	cullDescriptorSetLayout = descriptorLayoutCache.getLayout(bindings);
+
+	// pipeline layout: the set plus the culling push constants
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullPushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &cullDescriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create cull pipeline layout!");
+	}
+
+	// the compute pipeline itself (module comes from the shader cache,
+	// compilation results land in the shared pipeline cache)
+	VkPipelineShaderStageCreateInfo stageInfo{};
+	stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	stageInfo.module = Shader::getModule(device, "../shadercomp/cull.spv");
+	stageInfo.pName = "main";
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = stageInfo;
+	pipelineInfo.layout = cullPipelineLayout;
+
+	if (vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &cullPipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create cull compute pipeline!");
+	}
+
+	// one descriptor set per frame in flight, each pointing at that
+	// frame's buffer slices; the sets are written once and never change,
+	// so they come from the persistent arena
+	cullDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+	for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+		cullDescriptorSets[frame] = descriptorAllocator.allocate(cullDescriptorSetLayout);
+	}
+
+	for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+		std::array<VkDescriptorBufferInfo, 5> bufferInfos = {};
+		bufferInfos[0] = { instanceTransformBuffer, frame * sizeof(glm::vec4) * MAX_INSTANCES, sizeof(glm::vec4) * MAX_INSTANCES };
+		bufferInfos[1] = { instanceColorBuffer, frame * sizeof(glm::vec3) * MAX_INSTANCES, sizeof(glm::vec3) * MAX_INSTANCES };
+		bufferInfos[2] = { culledTransformBuffer, frame * sizeof(glm::vec4) * MAX_INSTANCES, sizeof(glm::vec4) * MAX_INSTANCES };
+		bufferInfos[3] = { culledColorBuffer, frame * sizeof(glm::vec3) * MAX_INSTANCES, sizeof(glm::vec3) * MAX_INSTANCES };
+		bufferInfos[4] = { indirectBuffer, frame * INDIRECT_SLICE_SIZE, sizeof(VkDrawIndexedIndirectCommand) };
+
+		std::array<VkWriteDescriptorSet, 5> writes = {};
+		for (uint32_t i = 0; i < writes.size(); i++) {
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = cullDescriptorSets[frame];
+			writes[i].dstBinding = i;
+			writes[i].dstArrayElement = 0;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].descriptorCount = 1;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+}
+
+void TriangleApplication::recordCullDispatch(VkCommandBuffer commandBuffer)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout,
+		0, 1, &cullDescriptorSets[currentFrame], 0, nullptr);
+
+	// the visible region: the NDC square plus a margin for the camera
+	// transform - conservative, the GPU test is per instance anyway
+	CullPushConstants push{};
+	push.instanceCount = instanceBatcher.instanceCount();
+	push.viewMin = glm::vec2(-2.0f, -2.0f);
+	push.viewMax = glm::vec2(2.0f, 2.0f);
+	vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+		0, sizeof(push), &push);
+
+	// one thread per instance, 64 per workgroup (matches cull.comp)
+	vkCmdDispatch(commandBuffer, (push.instanceCount + 63) / 64, 1, 1);
+
+	// the draw must not start before the compacted instance data and the
+	// indirect command are written
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void TriangleApplication::createCommandBuffers()
+{
+	// one command buffer per frame in flight, each from its own pool
+	commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+
+	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = frameCommandPools[i];
+		// specify if the allocated command buffers are:
+		// VK_COMMAND_BUFFER_LEVEL_PRIMARY: can be submitted to a queue for execution,
+		//									but cannot be called from other
+		//									command buffers
+		// VK_COMMAND_BUFFER_LEVEL_SECONDARY: cannot be submitted directly but can be called from primary
+		//									command buffers (it's helpfull to reuse common operations from
+		//									primary command buffers)
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffers[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate command buffers!");
+		}
+	}
+}
+
+void TriangleApplication::recordCommandBuffer(uint32_t imageIndex)
+{
+	VkCommandBuffer commandBuffer = commandBuffers[currentFrame];
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	// specify how the command buffer should be used
+	// VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT:
+	//		command buffer will be rerecorded after executing it once
+	// VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT
+	//		secondary command buffer that will be entirely within a single render pass
+	// VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT
+	//		command buffer can be resubmitted while its also already pending execution
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;	// re-recorded every frame
+	// only relevant for secondary command buffers;
+	// specifies which state to inherit from the calling primary command buffers
+	beginInfo.pInheritanceInfo = nullptr; // Optional
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to begin recording command buffers!");
+	}
+
+	if (timestampQueryPool != VK_NULL_HANDLE) {
+		// reset this image's two queries and write the "frame start" timestamp
+		vkCmdResetQueryPool(commandBuffer, timestampQueryPool, imageIndex * 2, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, imageIndex * 2);
+	}
+
+	if (gpuCulling) {
+		// cull and compact on the GPU before the render pass; the draw
+		// inside the pass reads only the compacted result
+		recordCullDispatch(commandBuffer);
+	}
+
+	// configure render pass
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	// renderpass itself
+	renderPassInfo.renderPass = renderPass;
+	// attachment to bind
+	renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+
+	// define the size of the render area (pixels outside will have undefined values)
+	// best performance when it matches the size of the attachment
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = swapChainExtent;
+
+	//define the clear values to use for VK_ATTACHMENT_LOAD_OP_CLEAR
+	// (indexed like the render pass attachments: color, then depth)
+	std::array<VkClearValue, 2> clearValues{};
+	clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };	// Define black with 100% opacity
+	// reversed-Z clears to 0 (= farthest); the classic convention to 1
+	clearValues[1].depthStencil = { reversedZ ? 0.0f : 1.0f, 0 };
+	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassInfo.pClearValues = clearValues.data();
+
+	// the draw work of the frame is recorded into secondary command buffers
+	// by the worker pool; one record batch per secondary buffer. The
+	// instance batcher has already sorted the frame's objects by pipeline
+	// and mesh, so this loop binds each pipeline once and issues a single
+	// instanced draw per bucket - a real scene splits the bucket list
+	// across several record batches of roughly equal cost
+	std::vector<RecordingWorkerPool::RecordBatch> batches;
+	batches.push_back([this](VkCommandBuffer secondary) {
+		// bind the geometry (meshId 0 - the only mesh so far)
+		// bindings 1 and 2 carry the per-instance SoA attributes of this
+		// frame's slice; on the GPU-driven path they point at the
+		// compacted buffers the culling dispatch wrote
+		VkBuffer vertexBuffers[] = {
+			vertexBuffer,
+			gpuCulling ? culledTransformBuffer : instanceTransformBuffer,
+			gpuCulling ? culledColorBuffer : instanceColorBuffer
+		};
+		VkDeviceSize offsets[] = {
+			0,
+			currentFrame * sizeof(glm::vec4) * MAX_INSTANCES,
+			currentFrame * sizeof(glm::vec3) * MAX_INSTANCES
+		};
+		vkCmdBindVertexBuffers(secondary, 0, 3, vertexBuffers, offsets);
+		vkCmdBindIndexBuffer(secondary, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+
+		// dynamic state is per command buffer - set it once here, it
+		// survives the pipeline binds below
+		setDynamicPipelineState(secondary, swapChainExtent);
+
+		// bind the uniform ring slice of this frame; the dynamic offset
+		// selects the slice, the descriptor set itself never changes
+		uint32_t dynamicOffset = static_cast<uint32_t>(currentFrame * uniformStride);
+
+		// per-draw data via push constants (values that are not worth a
+		// per-instance attribute)
+		PushConstantData push{};
+		push.tint = glm::vec4(1.0f);
+
+		if (gpuCulling) {
+			// GPU-driven: instanceCount lives in the indirect buffer, so
+			// this recording is the same few commands no matter how many
+			// objects were submitted (with several meshes/pipelines it
+			// becomes one indirect command per bucket)
+			vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+			vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+				0, 1, &descriptorSet, 1, &dynamicOffset);
+			vkCmdPushConstants(secondary, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+				0, sizeof(push), &push);
+
+			vkCmdDrawIndexedIndirect(secondary, indirectBuffer,
+				currentFrame * INDIRECT_SLICE_SIZE, 1, sizeof(VkDrawIndexedIndirectCommand));
+			return;
+		}
+
+		VkPipeline boundPipeline = VK_NULL_HANDLE;
+		for (const InstanceBatcher::Batch& batch : instanceBatcher.getBatches()) {
+			// state change only at bucket boundaries (the sort guarantees
+			// each pipeline appears in one contiguous run)
+			if (batch.pipeline != boundPipeline) {
+				vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, batch.pipeline);
+				vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+					0, 1, &descriptorSet, 1, &dynamicOffset);
+				vkCmdPushConstants(secondary, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+					0, sizeof(push), &push);
+				boundPipeline = batch.pipeline;
+			}
+
+			// Parameters:
+			//	Command Buffer
+			//	indexCount:		number of indices to draw
+			//	instanceCount:	the whole bucket in one call
+			//	firstIndex:		offset into the index buffer
+			//	vertexOffset:	value added to the indices before indexing into the vertex buffer
+			//	firstInstance:	offset for instanced rendering, defines the lowest value fo gl_InstanceIndex
+			vkCmdDrawIndexed(secondary, static_cast<uint32_t>(indices.size()),
+				batch.instanceCount, 0, 0, batch.firstInstance);
+		}
+	});
+
+	// the secondaries execute inside this render pass / framebuffer
+	VkCommandBufferInheritanceInfo inheritance{};
+	inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance.renderPass = renderPass;
+	inheritance.subpass = 0;
+	inheritance.framebuffer = swapChainFramebuffers[imageIndex];
+
+	std::vector<VkCommandBuffer> secondaries =
+		recordingWorkers.recordBatches(currentFrame, inheritance, batches);
+
+	// begin render pass
+	// the final parameter contols ow the drawing commands will be provided
+	// VK_SUBPASS_CONTENTS_INLINE: will be embedded in the primary command buffer itself and
+	//								no secondary command will be executed
+	// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS: will be executed from the secondary
+	//												command buffers
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		// splice the worker-recorded buffers into the primary
+		vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+	// end the render pass
+	vkCmdEndRenderPass(commandBuffer);
+
+	if (timestampQueryPool != VK_NULL_HANDLE) {
+		// "frame end" timestamp after all previous commands have finished
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, imageIndex * 2 + 1);
+	}
+
+	// finishe recording the command buffers
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record command buffer!");
+	}
+}
+
+void TriangleApplication::applyLatencyGovernor()
+{
+	auto now = std::chrono::steady_clock::now();
+
+	// update the frame interval average (outliers - resizes, debugger
+	// stops - are ignored so one hitch does not poison the prediction)
+	if (pacedLastFrameStart.time_since_epoch().count() != 0) {
+		double interval = std::chrono::duration<double, std::milli>(now - pacedLastFrameStart).count();
+		if (interval < 100.0) {
+			pacedFrameIntervalMs = pacedFrameIntervalMs == 0.0
+				? interval : pacedFrameIntervalMs * 0.9 + interval * 0.1;
+		}
+	}
+	pacedLastFrameStart = now;
+
+	if (!latencyGovernor || pacedFrameIntervalMs <= 0.0) {
+		pacedWorkStart = now;
+		return;
+	}
+
+	// sleep until just-in-time: the later the frame's work starts, the
+	// fresher its input is when the image reaches the screen. Budget =
+	// frame interval minus the predicted CPU and GPU work minus the
+	// safety margin (conservative - CPU and GPU partially overlap)
+	double sleepMs = pacedFrameIntervalMs - pacedCpuWorkMs - pacedGpuFrameMs - pacingMarginMs;
+	if (sleepMs > 0.25) {
+		std::this_thread::sleep_for(std::chrono::microseconds(static_cast<long long>(sleepMs * 1000.0)));
+	}
+
+	pacedWorkStart = std::chrono::steady_clock::now();
+}
+
+void TriangleApplication::drawFrame()
+{
+	FrameStats::ScopedTimer frameTimer(frameStats, FrameStats::PHASE_FRAME);
+
+	// pace the frame: delay its start so it completes just before the
+	// present deadline instead of queueing up behind the swap chain
+	applyLatencyGovernor();
+
+	// benchmark hook: force a swap chain recreation every N frames so the
+	// recreation path gets measured under repeatable conditions
+	if (benchRecreateEvery != 0 && framesRendered != 0 &&
+			framesRendered % benchRecreateEvery == 0) {
+		framebufferResized = true;
+	}
+
+	// wait here for the frame slot's previous submit: the host waits on
+	// the exact timeline value that submit signaled (0 on the first pass,
+	// which falls through)
+	{
+		FrameStats::ScopedTimer timer(frameStats, FrameStats::PHASE_WAIT_FENCES);
+		graphicsTimeline.hostWait(frameTimelineValues[currentFrame]);
+	}
+
+	// a frame wait just completed - age the deferred-destruction queue
+	// and destroy the entries no frame in flight can reference anymore
+	frameGarbage.collect();
+
+	// a hot-reloaded pipeline waiting? swap it in at this frame boundary
+	applyPendingPipeline();
+
+	// aquiring an image from the swap chain
+	// ------------------------------------
+	uint32_t imageIndex;
+	// parameters:
+	//	device - logical device
+	//	swapChain - swap chain from which the image should be acquired
+	//	timeout - timeout in nanoseconds for an image to become available (UINT64_MAX disables the timeout)
+	//	synchronication object (semaphore) - to be signaled when the presentation engine is finished
+	//  synchronication object (fence) - to be signaled when the presentation engine is finished
+	//	index - index of the swap chain image in the swapChainImages Array
+	VkResult result;
+	{
+		FrameStats::ScopedTimer timer(frameStats, FrameStats::PHASE_ACQUIRE);
+		result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphore[currentFrame], VK_NULL_HANDLE, &imageIndex);
+	}
+
+	// check if swap chain needs to be recreated
+	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+		// VK_ERROR_OUT_OF_DATE_KHR -  The swap chain has become incompatible with the surface and can no longer be used for rendering. 
+		// Usually happens after a window resize.
+		recreateSwapChain();
+		return;
+	}
+	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+		//  VK_SUBOPTIMAL_KHR - The swap chain can still be used to successfully present to the surface, 
+		// but the surface properties are no longer matched exactly.
+		throw std::runtime_error("failed to acquire swap chain image!");
+	}
+
+	// Check if a previous frame is using this image: wait until the
+	// timeline passes the value of the last submit that rendered into it
+	graphicsTimeline.hostWait(imageTimelineValues[imageIndex]);
+
+	// the previous submission that used this image has finished,
+	// so its GPU timestamps can be read back now
+	collectGpuTimestamps(imageIndex);
+
+	// recycle this frame's pools in one cheap bulk operation and re-record
+	// the frame's command buffer for the acquired image
+	vkResetCommandPool(device, frameCommandPools[currentFrame], 0);
+	recordingWorkers.resetFrame(currentFrame);
+	bufferAllocator.beginFrame(currentFrame);
+	// whole-pool reset of the frame's transient descriptor arena
+	descriptorAllocator.beginFrame(currentFrame);
+	// tick the texture streamer: kicks off uploads for freshly decoded
+	// images and retires finished ones (polling only, never blocks)
+	textureStreamer.update();
+	updateUniformBuffer(currentFrame);
+	buildFrameInstances(currentFrame);
+	recordCommandBuffer(imageIndex);
+
+	// acquire and record the additional windows; a window whose swap
+	// chain went out of date sits this frame out and is recreated after
+	// the present below
+	for (WindowContext& ctx : extraWindows) {
+		VkResult acquire = vkAcquireNextImageKHR(device, ctx.swapChain, UINT64_MAX,
+			ctx.imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &ctx.imageIndex);
+		if (acquire == VK_ERROR_OUT_OF_DATE_KHR) {
+			ctx.activeThisFrame = false;
+			ctx.framebufferResized = true;
+			continue;
+		}
+		else if (acquire != VK_SUCCESS && acquire != VK_SUBOPTIMAL_KHR) {
+			throw std::runtime_error("failed to acquire swap chain image!");
+		}
+		ctx.activeThisFrame = true;
+		recordWindowCommandBuffer(ctx);
+	}
+
+	// submitting the command buffer
+	// -----------------------------
+	// Queue submission and synchronization configuration
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+	// specify which semaphores to wait on before execution begins:
+	// every window's command buffer goes into this one submit, so the
+	// submit waits on every window's acquire semaphore (one shared
+	// signal set covers them all)
+	std::vector<VkSemaphore> waitSemaphores = { imageAvailableSemaphore[currentFrame] };
+	// specify which stages of the pipeline to wait
+	std::vector<VkPipelineStageFlags> waitStages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };	// Stage: Writing colors to image buffer
+	std::vector<VkCommandBuffer> frameSubmitBuffers = { commandBuffers[currentFrame] };
+	for (WindowContext& ctx : extraWindows) {
+		if (!ctx.activeThisFrame) {
+			continue;
+		}
+		waitSemaphores.push_back(ctx.imageAvailableSemaphores[currentFrame]);
+		waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+		frameSubmitBuffers.push_back(ctx.commandBuffers[currentFrame]);
+	}
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	// each entry in the wait Stages array corresponds to the semaphore with the same index in pWaitEmaphores
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
+
+	// specify command buffers to actually submit for execution
+	submitInfo.commandBufferCount = static_cast<uint32_t>(frameSubmitBuffers.size());
+	submitInfo.pCommandBuffers = frameSubmitBuffers.data();
+
+	// this submit's spot on the graphics timeline: the frame slot wait and
+	// the image reuse check above key on it next time around
+	uint64_t frameValue = graphicsTimeline.nextValue();
+	frameTimelineValues[currentFrame] = frameValue;
+	imageTimelineValues[imageIndex] = frameValue;
+
+	// specify which semaphores to signale once the command buffers(s) have
+	// finish execution: the binary one feeds the present below, the
+	// timeline value replaces the frame fence. The values ride along in
+	// the pNext chain; binary semaphores ignore their value slots
+	VkSemaphore signalSemaphores[] = { renderFinishedSemaphore[currentFrame], graphicsTimeline.handle() };
+	uint64_t signalValues[] = { 0, frameValue };
+	std::vector<uint64_t> waitValues(waitSemaphores.size(), 0);	// all binary acquires
+
+	VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+	timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+	timelineInfo.pWaitSemaphoreValues = waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = 2;
+	timelineInfo.pSignalSemaphoreValues = signalValues;
+	submitInfo.pNext = &timelineInfo;
+
+	submitInfo.signalSemaphoreCount = 2;
+	submitInfo.pSignalSemaphores = signalSemaphores;
+
+	// submit the command buffer to the graphics queue (no fence - the
+	// timeline value above is the completion marker)
+	{
+		FrameStats::ScopedTimer timer(frameStats, FrameStats::PHASE_SUBMIT);
+		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit draw command buffer!");
+		}
+	}
+
+	// feed the governor's CPU work prediction (time from the end of the
+	// pacing sleep until the submit went out, including the waits)
+	{
+		double cpuWork = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - pacedWorkStart).count();
+		pacedCpuWorkMs = pacedCpuWorkMs == 0.0
+			? cpuWork : pacedCpuWorkMs * 0.9 + cpuWork * 0.1;
+	}
+
+	// Presentation
+	// ------------
+	// submitting the result back to the swap chain to have it show up on the screen
+
+	VkPresentInfoKHR presentInfo{};
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+
+	// specify which semaphores ot wait on before presentation
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = signalSemaphores;
+
+	// specify the swap chains to present images to and the index of the
+	// image for each swap chain - all windows go out in this one call,
+	// so the presentation engine flips them together
+	std::vector<VkSwapchainKHR> presentSwapChains = { swapChain };
+	std::vector<uint32_t> presentImageIndices = { imageIndex };
+	for (WindowContext& ctx : extraWindows) {
+		if (!ctx.activeThisFrame) {
+			continue;
+		}
+		presentSwapChains.push_back(ctx.swapChain);
+		presentImageIndices.push_back(ctx.imageIndex);
+	}
+	presentInfo.swapchainCount = static_cast<uint32_t>(presentSwapChains.size());
+	presentInfo.pSwapchains = presentSwapChains.data();
+	presentInfo.pImageIndices = presentImageIndices.data();
+
+	// specify an array of VkResult values  to check for every individual swap chain if presentation was successfull
+	std::vector<VkResult> presentResults(presentSwapChains.size());
+	presentInfo.pResults = presentResults.data();
+	// submit the request to present an image to the swap chain
+	{
+		FrameStats::ScopedTimer timer(frameStats, FrameStats::PHASE_PRESENT);
+		result = vkQueuePresentKHR(presentQueue, &presentInfo);
+	}
+
+	// the first window keeps its incremental recreation path
+	result = presentResults[0];
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
+		framebufferResized = false;
+		recreateSwapChain();
+	}
+	else if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to present swap chain image!");
+	}
+
+	// per-window recreation: out-of-date presents and the resize flags
+	// set by the callback (or a skipped acquire above)
+	size_t presentResultIndex = 1;
+	for (WindowContext& ctx : extraWindows) {
+		VkResult windowResult = ctx.activeThisFrame ? presentResults[presentResultIndex++] : VK_SUCCESS;
+		if (windowResult == VK_ERROR_OUT_OF_DATE_KHR || windowResult == VK_SUBOPTIMAL_KHR || ctx.framebufferResized) {
+			ctx.framebufferResized = false;
+			recreateWindowSwapChain(ctx);
+		}
+		else if (windowResult != VK_SUCCESS) {
+			throw std::runtime_error("failed to present swap chain image!");
+		}
+	}
+
+	// advance current frame to the next
+	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+
+	noteFrameRendered();
+
+	// close out the statistics window for this frame (dumps periodically)
+	frameStats.endFrame();
+}
+
+void TriangleApplication::drawFrameHeadless()
+{
+	FrameStats::ScopedTimer frameTimer(frameStats, FrameStats::PHASE_FRAME);
+
+	// pacing comes solely from the frame timeline waits - no acquire, no vsync
+	{
+		FrameStats::ScopedTimer timer(frameStats, FrameStats::PHASE_WAIT_FENCES);
+		graphicsTimeline.hostWait(frameTimelineValues[currentFrame]);
+	}
+
+	// age the deferred-destruction queue and swap in a hot-reloaded
+	// pipeline, exactly like the windowed path
+	frameGarbage.collect();
+	applyPendingPipeline();
+
+	// walk the offscreen ring instead of asking a presentation engine
+	uint32_t imageIndex = static_cast<uint32_t>(currentFrame % swapChainImages.size());
+
+	// wait until the previous frame that rendered into this image is done
+	graphicsTimeline.hostWait(imageTimelineValues[imageIndex]);
+
+	collectGpuTimestamps(imageIndex);
+
+	vkResetCommandPool(device, frameCommandPools[currentFrame], 0);
+	recordingWorkers.resetFrame(currentFrame);
+	bufferAllocator.beginFrame(currentFrame);
+	descriptorAllocator.beginFrame(currentFrame);
+	textureStreamer.update();
+	updateUniformBuffer(currentFrame);
+	buildFrameInstances(currentFrame);
+	recordCommandBuffer(imageIndex);
+
+	// submit with only the timeline signal - no presentation engine means
+	// no binary semaphores at all on this path
+	uint64_t frameValue = graphicsTimeline.nextValue();
+	frameTimelineValues[currentFrame] = frameValue;
+	imageTimelineValues[imageIndex] = frameValue;
+
+	VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &frameValue;
+
+	VkSemaphore signalSemaphore = graphicsTimeline.handle();
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &signalSemaphore;
+
+	{
+		FrameStats::ScopedTimer timer(frameStats, FrameStats::PHASE_SUBMIT);
+		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit draw command buffer!");
+		}
+	}
+
+	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+
+	noteFrameRendered();
+
+	frameStats.endFrame();
+}
+
+std::vector<uint8_t> TriangleApplication::readbackImage(uint32_t imageIndex)
+{
+	if (!headless) {
+		throw std::runtime_error("readbackImage() is only available in headless mode!");
+	}
+
+	// simple and safe: drain the device, then copy at leisure
+	vkDeviceWaitIdle(device);
+
+	// 4 bytes per pixel for the B8G8R8A8 offscreen format
+	VkDeviceSize imageSize = (VkDeviceSize)swapChainExtent.width * swapChainExtent.height * 4;
+
+	// host visible target buffer for the copy
+	VkBuffer readbackBuffer;
+	BufferAllocator::Allocation readbackAllocation;
+	createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		readbackBuffer, readbackAllocation);
+
+	VkCommandBuffer commandBuffer = beginSingleTimeCommands(transferCommandPool);
+
+	VkBufferImageCopy region{};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;		// tightly packed
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { swapChainExtent.width, swapChainExtent.height, 1 };
+
+	// the render pass left the image in TRANSFER_SRC_OPTIMAL
+	vkCmdCopyImageToBuffer(commandBuffer, swapChainImages[imageIndex],
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+	endSingleTimeCommands(commandBuffer, transferQueue, transferCommandPool);
+
+	// the allocator keeps host visible blocks mapped - copy straight out
+	std::vector<uint8_t> pixels(imageSize);
+	memcpy(pixels.data(), readbackAllocation.mapped, (size_t)imageSize);
+
+	vkDestroyBuffer(device, readbackBuffer, nullptr);
+	bufferAllocator.free(readbackAllocation);
+
+	return pixels;
+}
+
+int TriangleApplication::rateDeviceSuitability(VkPhysicalDevice device) {
+	// a device that cannot run the application at all scores zero,
+	// regardless of how fast it would be
+	if (!isDeviceSuitable(device)) {
+		return 0;
+	}
+
+	VkPhysicalDeviceProperties deviceProperties;
+
+	// Querying for name, type, supported Vulkan version
+	vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+	int score = 0;
+
+	// Discrete GPUs have a significant  performance advantage
+	if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
+		score += 1000;
+	}
+
+	// Maximum possible size of textures affects graphics quality
+	score += deviceProperties.limits.maxImageDimension2D;
+
+	// device local heap size is the best single predictor of how much
+	// scene the card can hold - on multi GPU nodes this separates the
+	// render GPU from the small display GPU
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+
+	VkDeviceSize deviceLocalBytes = 0;
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+		if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+			deviceLocalBytes += memoryProperties.memoryHeaps[i].size;
+		}
+	}
+	// one point per 16 MB of VRAM (an 8 GB card adds 512 points)
+	score += static_cast<int>(deviceLocalBytes / (16 * 1024 * 1024));
+
+	// a memory type that is both device local and host visible (resizable
+	// BAR) makes uploads considerably cheaper
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+		if ((flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) &&
+			(flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+			// only worth the bonus if the heap behind it is not just the
+			// classic 256 MB BAR window
+			if (memoryProperties.memoryHeaps[memoryProperties.memoryTypes[i].heapIndex].size > 256 * 1024 * 1024) {
+				score += 200;
+			}
+			break;
+		}
+	}
+
+	// dedicated async families mean uploads and compute can overlap
+	// rendering instead of serializing on the graphics queue
+	QueueFamilyIndices indices = findQueueFamilies(device);
+	if (indices.transferFamily.has_value() &&
+		indices.transferFamily != indices.graphicsFamily) {
+		score += 100;
+	}
+	if (indices.computeFamily.has_value() &&
+		indices.computeFamily != indices.graphicsFamily) {
+		score += 100;
+	}
+
+	return score;
+}
+
+SwapChainSupportDetails TriangleApplication::querySwapChainSupport(VkPhysicalDevice device)
+{
+	// the single-parameter version queries the first window's surface
+	return querySwapChainSupport(device, surface);
+}
+
+SwapChainSupportDetails TriangleApplication::querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR querySurface)
+{
+	SwapChainSupportDetails details;
+
+	// check basic surface capabilites
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, querySurface, &details.capabilities);
+
+	// querying the supported surface formats
+	uint32_t formatCount;
+	vkGetPhysicalDeviceSurfaceFormatsKHR(device, querySurface, &formatCount, nullptr);
+
+	if (formatCount != 0) {
+		details.formats.resize(formatCount);
+		// make sure that the vector is resized to hold all the available formats
+		vkGetPhysicalDeviceSurfaceFormatsKHR(device, querySurface, &formatCount, details.formats.data());
+	}
+
+	// querying the supported presentation modes
+	uint32_t presentModeCount;
+	vkGetPhysicalDeviceSurfacePresentModesKHR(device, querySurface, &presentModeCount, nullptr);
+
+	if (presentModeCount != 0) {
+		details.presentModes.resize(presentModeCount);
+		vkGetPhysicalDeviceSurfacePresentModesKHR(device, querySurface, &presentModeCount, details.presentModes.data());
+	}
+
+	return details;
 }
 
 /*
@@ -720,13 +2110,19 @@ bool TriangleApplication::isDeviceSuitable(VkPhysicalDevice device) {
 	//Ensure that the device can process the commands to be used
 	QueueFamilyIndices indices = findQueueFamilies(device);
 
+	// headless mode neither needs the swap chain extension nor a surface
+	// to be adequate for
+	if (headless) {
+		return indices.isComplete();
+	}
+
 	bool extensionsSupported = checkDeviceExtensionSupport(device);
 
 	bool swapChainAdequate = false;
 	// imported that query for swap chain support after that the extension is available
 	if (extensionsSupported) {
 		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
-		// check if there's at leaste one supported image formate and one supported presentation mode 
+		// check if there's at leaste one supported image formate and one supported presentation mode
 		// given the window surface we have
 		swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 	}
@@ -767,24 +2163,54 @@ QueueFamilyIndices TriangleApplication::findQueueFamilies(VkPhysicalDevice devic
 
 	int i = 0;
 	for (const auto& queueFamily : queueFamilies) {
-		// Find device that 
-		if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+		// Find device that
+		if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT &&
+			!indices.graphicsFamily.has_value()) {
 			indices.graphicsFamily = i;
 		}
 
 		// look for a queue family that has the capability of presenting to our
-		// window surface
+		// window surface (headless mode has no surface to present to)
 		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+		if (!headless) {
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+		}
 
 		// check the value of the boolean and store the presentation family queue index
-		if (queueFamily.queueCount > 0 && presentSupport) {
+		if (queueFamily.queueCount > 0 && presentSupport &&
+			!indices.presentFamily.has_value()) {
 			indices.presentFamily = i;
 		}
 
-		if (indices.isComplete()) {
-			break;
+		i++;
+	}
+
+	// without a surface there is no present family; alias it to the
+	// graphics family so isComplete() and the queue setup work unchanged
+	if (headless) {
+		indices.presentFamily = indices.graphicsFamily;
+	}
+
+	// second pass: look for dedicated async families
+	// a transfer-only family maps to the DMA engine on discrete GPUs and
+	// a compute-without-graphics family can run while the graphics queue renders
+	i = 0;
+	for (const auto& queueFamily : queueFamilies) {
+		if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT)) {
+			bool dedicated = !(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+			// take the first family with the bit, prefer a dedicated one
+			if (!indices.transferFamily.has_value() || dedicated) {
+				indices.transferFamily = i;
+			}
+		}
+
+		if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+			bool dedicated = !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+			if (!indices.computeFamily.has_value() || dedicated) {
+				indices.computeFamily = i;
+			}
 		}
+
 		i++;
 	}
 
@@ -796,7 +2222,10 @@ void TriangleApplication::populateDebugMessengerCreateInfo(VkDebugUtilsMessenger
 	createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
 	//allows specifing all the types of serverities you would like the callback to be called for
-	createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+	//subscribe to everything: the runtime filter in debugCallback decides
+	//what gets printed, and counting the rest is cheap - this way the
+	//filter can be widened at runtime without recreating the messenger
+	createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
 	//except for: VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT  
 	//filter which types of messages the callback is notified about
 	createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
@@ -813,10 +2242,12 @@ void TriangleApplication::setupDebugCallback() {
 	//Fill a structure with details about the callback
 	VkDebugUtilsMessengerCreateInfoEXT createInfo;
 
-	createInfo.pUserData = nullptr; //optional eg. pointer to TriangleApplication class
-
 	populateDebugMessengerCreateInfo(createInfo);
 
+	// the callback reads its filter/counter state through this pointer
+	// (set after populate - populate zero-initializes the struct)
+	createInfo.pUserData = this;
+
 	if (CreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr, &debugMessenger) != VK_SUCCESS) {
 		throw std::runtime_error("failed to set up debug messenger!");
 	}
@@ -826,51 +2257,230 @@ void TriangleApplication::setupDebugCallback() {
  * Main Loop iterates until Window ist closed
  */
 void TriangleApplication::mainLoop() {
-	while (!glfwWindowShouldClose(window)) {
-		//
-		glfwPollEvents();
-		drawFrame();
+	auto loopStart = std::chrono::steady_clock::now();
+
+	if (headless) {
+		// batch mode: a fixed number of frames, back-to-back (no window,
+		// no events - a single thread is all there is to it)
+		for (uint32_t frame = 0; frame < headlessFrameCount; frame++) {
+			drawFrameHeadless();
+		}
+	}
+	else {
+		// windowed: the frame loop moves to its own thread and this one
+		// keeps pumping GLFW events (a GLFW requirement anyway). Input,
+		// resize and close handling no longer wait out drawFrame()'s
+		// blocking calls - the window stays responsive however long the
+		// GPU takes
+		renderThreadRunning = true;
+		std::thread renderThread(&TriangleApplication::renderLoop, this);
+
+		// glfwWaitEvents sleeps until events arrive, so this loop costs
+		// nothing while idle; the render thread posts an empty event on
+		// exit to wake it for the join
+		while (renderThreadRunning) {
+			glfwWaitEvents();
+		}
+		renderThread.join();
 	}
 
+	frameLoopMs = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - loopStart).count();
+
 	// wait until operations are done
 	vkDeviceWaitIdle(device);
 
 
 }
 
+void TriangleApplication::renderLoop() {
+	// frameLimit stops the windowed loop after a fixed number of
+	// frames - that is how the benchmark harness gets deterministic
+	// windowed runs (glfwWindowShouldClose is callable from any thread)
+	while (!glfwWindowShouldClose(window) &&
+			(frameLimit == 0 || framesRendered < frameLimit)) {
+		drainWindowEvents();
+		drawFrame();
+	}
+
+	// wake the main thread out of glfwWaitEvents so it can join
+	renderThreadRunning = false;
+	glfwPostEmptyEvent();
+}
+
+void TriangleApplication::drainWindowEvents() {
+	WindowEventQueue::Event event;
+	while (windowEvents.pop(event)) {
+		switch (event.type) {
+		case WindowEventQueue::Type::FRAMEBUFFER_RESIZED:
+			if (event.windowIndex == 0) {
+				framebufferWidth = event.width;
+				framebufferHeight = event.height;
+				framebufferResized = true;
+			}
+			else if (event.windowIndex - 1 < extraWindows.size()) {
+				WindowContext& ctx = extraWindows[event.windowIndex - 1];
+				ctx.framebufferWidth = event.width;
+				ctx.framebufferHeight = event.height;
+				ctx.framebufferResized = true;
+			}
+			break;
+		}
+	}
+}
+
 /*
  * Deallocate the resources
  */
 void TriangleApplication::cleanup() {
+	// stop the shader watcher before any of the objects its rebuild
+	// callback touches (device, pipeline cache, shader cache) go away
+	shaderReloader.destroy();
+	if (pendingPipeline != VK_NULL_HANDLE) {
+		// built but never swapped in - safe to destroy directly
+		vkDestroyPipeline(device, pendingPipeline, nullptr);
+		vkDestroyPipelineLayout(device, pendingPipelineLayout, nullptr);
+	}
+
+	// mainLoop() already waited for the device to go idle, so anything
+	// still in the deferred-destruction queue can go immediately
+	frameGarbage.flush();
+
+	// additional windows: everything they own (the shared render pass and
+	// pipeline go down with the first window's cleanupSwapChain below;
+	// their command buffers are freed with the frame pools)
+	for (WindowContext& ctx : extraWindows) {
+		for (auto framebuffer : ctx.framebuffers) {
+			vkDestroyFramebuffer(device, framebuffer, nullptr);
+		}
+		for (auto imageView : ctx.imageViews) {
+			vkDestroyImageView(device, imageView, nullptr);
+		}
+		if (ctx.colorImage != VK_NULL_HANDLE) {
+			vkDestroyImageView(device, ctx.colorImageView, nullptr);
+			vkDestroyImage(device, ctx.colorImage, nullptr);
+			bufferAllocator.free(ctx.colorAllocation);
+		}
+		vkDestroyImageView(device, ctx.depthImageView, nullptr);
+		vkDestroyImage(device, ctx.depthImage, nullptr);
+		bufferAllocator.free(ctx.depthAllocation);
+		vkDestroySwapchainKHR(device, ctx.swapChain, nullptr);
+		for (auto semaphore : ctx.imageAvailableSemaphores) {
+			vkDestroySemaphore(device, semaphore, nullptr);
+		}
+		vkDestroySurfaceKHR(instance, ctx.surface, nullptr);
+	}
+
 	cleanupSwapChain();
-	// clean up semaphores 
+
+	// persist the pipeline cache for the next launch, then destroy it
+	savePipelineCache();
+	vkDestroyPipelineCache(device, pipelineCache, nullptr);
+
+	if (timestampQueryPool != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+	}
+
+	// clean up the binary (presentation engine) semaphores
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 		vkDestroySemaphore(device, renderFinishedSemaphore[i], nullptr);
 		vkDestroySemaphore(device, imageAvailableSemaphore[i], nullptr);
-		vkDestroyFence(device, inFlightFences[i], nullptr);
 	}
-	
+
+	// stop the texture IO thread and drain the in-flight uploads before
+	// the allocator's memory goes away
+	textureStreamer.destroy();
+
+	// the queue timelines go last among the sync objects - the streamer
+	// drain above still waits on them
+	graphicsTimeline.destroy();
+	transferTimeline.destroy();
+
+	// final occupancy/fragmentation report before the memory goes away
+	bufferAllocator.dumpStatistics();
+
+	// descriptor infrastructure: the pools free every set, the cache
+	// every layout (descriptorSetLayout, cullDescriptorSetLayout)
+	descriptorAllocator.destroy();
+	descriptorLayoutCache.destroy();
+
+	// uniform streaming objects
+	vkDestroyBuffer(device, uniformBuffer, nullptr);
+	bufferAllocator.free(uniformBufferAllocation);
+
+	// per-frame instance attribute buffers
+	vkDestroyBuffer(device, instanceTransformBuffer, nullptr);
+	bufferAllocator.free(instanceTransformAllocation);
+	vkDestroyBuffer(device, instanceColorBuffer, nullptr);
+	bufferAllocator.free(instanceColorAllocation);
+
+	// GPU culling resources
+	if (gpuCulling) {
+		vkDestroyPipeline(device, cullPipeline, nullptr);
+		vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+		vkDestroyBuffer(device, culledTransformBuffer, nullptr);
+		bufferAllocator.free(culledTransformAllocation);
+		vkDestroyBuffer(device, culledColorBuffer, nullptr);
+		bufferAllocator.free(culledColorAllocation);
+		vkDestroyBuffer(device, indirectBuffer, nullptr);
+		bufferAllocator.free(indirectAllocation);
+	}
+
+	// geometry buffers and the memory pools backing them
+	vkDestroyBuffer(device, indexBuffer, nullptr);
+	bufferAllocator.free(indexBufferAllocation);
+	vkDestroyBuffer(device, vertexBuffer, nullptr);
+	bufferAllocator.free(vertexBufferAllocation);
+	bufferAllocator.destroy();
+
+	// stop the recording workers before their pools are destroyed
+	recordingWorkers.destroy();
+
+	// drop the cached shader modules
+	Shader::destroyModules(device);
+
 	vkDestroyCommandPool(device, commandPool, nullptr);
+	vkDestroyCommandPool(device, transferCommandPool, nullptr);
+	vkDestroyCommandPool(device, computeCommandPool, nullptr);
+	for (auto framePool : frameCommandPools) {
+		vkDestroyCommandPool(device, framePool, nullptr);
+	}
 
 	// destroy logical device
 	vkDestroyDevice(device, nullptr);
 
 	//Destroy Debug Util
 	if (enableValidationLayers) {
+		// message counters are the instrumentation surface; a summary at
+		// shutdown replaces per-message stderr spam during the run
+		std::cout << "validation messages: "
+			<< debugMessageCounts[0] << " verbose, "
+			<< debugMessageCounts[1] << " info, "
+			<< debugMessageCounts[2] << " warning, "
+			<< debugMessageCounts[3] << " error ("
+			<< debugMessagesSuppressed << " suppressed)" << std::endl;
+
 		DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
 	}
 
-	// destroying the surface
-	vkDestroySurfaceKHR(instance, surface, nullptr);	// has to be destroyed before the instance
+	if (!headless) {
+		// destroying the surface
+		vkDestroySurfaceKHR(instance, surface, nullptr);	// has to be destroyed before the instance
+	}
 
 	/* All other Vulkan resources created, should be cleaned up before,
 	 * the instance is destoyed
 	 */
 	vkDestroyInstance(instance, nullptr);
 
-	glfwDestroyWindow(window);
+	if (!headless) {
+		for (WindowContext& ctx : extraWindows) {
+			glfwDestroyWindow(ctx.window);
+		}
+		glfwDestroyWindow(window);
 
-	glfwTerminate();
+		glfwTerminate();
+	}
 }
 
 /// <summary>
@@ -883,18 +2493,26 @@ void TriangleApplication::createFramebuffers()
 
 	// iterate through the image views and create frambuffers from them
 	for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-		VkImageView attachments[] = {
-			swapChainImageViews[i]
-		};
+		// the one depth image (and with MSAA the one color target) is
+		// shared by all framebuffers - only one render pass instance runs
+		// at a time (see the subpass dependency). With MSAA the swap chain
+		// image moves to slot 2, the resolve attachment
+		std::vector<VkImageView> attachments;
+		if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+			attachments = { colorImageView, depthImageView, swapChainImageViews[i] };
+		}
+		else {
+			attachments = { swapChainImageViews[i], depthImageView };
+		}
 
 		VkFramebufferCreateInfo framebufferInfo{};
 		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 		// set renderPass with which the framebuffer needs to be compatible with
 		framebufferInfo.renderPass = renderPass;
-		// specification of the VkImageView Objects the should be bound to the 
+		// specification of the VkImageView Objects the should be bound to the
 		// respective attachment description in the render pass pAttachment array
-		framebufferInfo.attachmentCount = 1;
-		framebufferInfo.pAttachments = attachments;
+		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		framebufferInfo.pAttachments = attachments.data();
 
 		framebufferInfo.width = swapChainExtent.width;
 		framebufferInfo.height = swapChainExtent.height;
@@ -913,17 +2531,21 @@ void TriangleApplication::createFramebuffers()
  * @return required list of extensions (whether validation layers are enabled or not)
  */
 std::vector<const char*> TriangleApplication::getRequiredExtensions() {
-	uint32_t glfwExtensionsCount = 0;
-	const char** glfwExtensions;
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
-
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionsCount);
-
-	if (enableValidationLayers) {
-		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME); //equal to VK_EXT_debug_utils
-		//Debug report extension is conditionally added
+	// headless mode needs neither VK_KHR_surface nor the platform surface
+	// extension, so GLFW is not consulted at all
+	std::vector<const char*> extensions;
+	if (!headless) {
+		uint32_t glfwExtensionsCount = 0;
+		const char** glfwExtensions;
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
+
+		extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionsCount);
 	}
 
+	// the debug utils extension is appended by the bootstrap library
+	// itself when validation is on - only the surface extensions are
+	// this application's business
+
 	return extensions;
 }
 
@@ -932,56 +2554,28 @@ std::vector<const char*> TriangleApplication::getRequiredExtensions() {
  * Creates instance (connection between app and Vulkan Library)
  */
 void TriangleApplication::createInstance() {
-	if (enableValidationLayers && !checkValidationLayerSupport()) {
-		throw std::runtime_error("validation layers requested, but not available!");
-	}
-
-	// Fill a struct with Informationen about Application 
-	// (optional), may provide useful informationen to the driver for optimisation
-	VkApplicationInfo appInfo = {};
-	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;	//specify struct Type
-	appInfo.pApplicationName = "Application Name";
-	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.pEngineName = "No Engine";
-	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0;
-
-	// (non optional) tells the Vulkan driver which global extension and validation 
-	// layers we want to use
-	VkInstanceCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-	createInfo.pApplicationInfo = &appInfo;
-
+	// the shared bootstrap library builds the create info from its
+	// compile-time tables and verifies the validation layers against its
+	// cached layer enumeration - no loader round-trips beyond the one
+	// first-use pass
+	vkbootstrap::InstanceOptions options;
+	options.applicationName = "Application Name";
+	// 1.1 makes vkGetPhysicalDeviceMemoryProperties2 core, which the
+	// allocator's budget tracking queries through
+	options.apiVersion = VK_API_VERSION_1_1;
+	options.enableValidationLayers = enableValidationLayers;
 	// Get Extension to interface with the window system
-	auto extensions = getRequiredExtensions();
-
-	// enabling the device extension 
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
-	createInfo.ppEnabledExtensionNames = extensions.data();
+	options.extensions = getRequiredExtensions();
 
+	// hand the messenger create info along so instance creation and
+	// destruction are covered by the callback too
 	VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo;
-
-	// enable/disable global validation layer
 	if (enableValidationLayers) {
-		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-		createInfo.ppEnabledLayerNames = validationLayers.data();
-
 		populateDebugMessengerCreateInfo(debugCreateInfo);
-		createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
-	}
-	else {
-		createInfo.enabledLayerCount = 0;
-
-		createInfo.pNext = nullptr;
+		options.pNext = &debugCreateInfo;
 	}
 
-	// Parameters 
-	// - pointer to struct with creation info
-	// - pointer to custom allocator callbacks
-	// - pointer to the variable that stores the handle to the new object
-	if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create instance!");
-	}
+	instance = vkbootstrap::createInstance(options);
 
 	// Debug
 	//checkForExtensionSupport();
@@ -991,16 +2585,9 @@ void TriangleApplication::createInstance() {
  * Checkin for extension support
  */
 void TriangleApplication::checkForExtensionSupport() {
-	//Number of exensions
-	uint32_t extensionCount = 0;
-	//retrieve number of extensions (leaving latter paramter empty
-	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
-
-	//allocate an array to hold extensions details
-	std::vector<VkExtensionProperties> extensions(extensionCount);
-
-	//query extensions details
-	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+	// the bootstrap library's cached enumeration - shared with every
+	// other caller, including instance creation
+	const std::vector<VkExtensionProperties>& extensions = vkbootstrap::instanceExtensions();
 
 	std::cout << "available extensions:" << std::endl;
 
@@ -1038,31 +2625,9 @@ void TriangleApplication::checkForExtensionSupport() {
  * Checks if all of the requested layers are available.
  */
 bool TriangleApplication::checkValidationLayerSupport() {
-
-	//Get available Layers
-	uint32_t layerCount;
-	vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
-
-	std::vector<VkLayerProperties> availableLayers(layerCount);
-	vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
-
-	//Check if all layers in valdiationLayers exist in the availableLayers list
-	for (const char * layerName : validationLayers) {
-		bool layerFound = false;
-
-		for (const auto& layerProperties : availableLayers) {
-			if (strcmp(layerName, layerProperties.layerName) == 0) {
-				layerFound = true;
-				break;
-			}
-		}
-
-		if (!layerFound) {
-			return false;
-		}
-	}
-
-	return true;
+	// the layer enumeration and the compile-time layer table both live
+	// in the bootstrap library - this just forwards
+	return vkbootstrap::validationLayersSupported();
 }
 
 VkSurfaceFormatKHR TriangleApplication::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
@@ -1102,9 +2667,27 @@ VkPresentModeKHR TriangleApplication::chooseSwapPresentMode(const std::vector<Vk
 	 *
 	 */
 
-	for (const auto& availablePresentMode : availablePresentModes) {
-		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-			return availablePresentMode;
+	// preference order per policy; the first available mode wins
+	std::vector<VkPresentModeKHR> preferred;
+	switch (presentPolicy) {
+	case PresentPolicy::LOW_LATENCY:
+		// newest frame wins without tearing; immediate as a lesser evil
+		preferred = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+		break;
+	case PresentPolicy::UNCAPPED:
+		// raw throughput first, mailbox as the untorn runner-up
+		preferred = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR };
+		break;
+	case PresentPolicy::VSYNC:
+		// fall straight through to FIFO
+		break;
+	}
+
+	for (VkPresentModeKHR candidate : preferred) {
+		for (const auto& availablePresentMode : availablePresentModes) {
+			if (availablePresentMode == candidate) {
+				return availablePresentMode;
+			}
 		}
 	}
 
@@ -1112,18 +2695,45 @@ VkPresentModeKHR TriangleApplication::chooseSwapPresentMode(const std::vector<Vk
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+uint32_t TriangleApplication::chooseSwapImageCount(const VkSurfaceCapabilitiesKHR& capabilities, VkPresentModeKHR presentMode)
+{
+	uint32_t imageCount;
+
+	if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+		// mailbox only beats FIFO if there is a spare image the application
+		// can replace while another is queued - minimum plus one
+		imageCount = capabilities.minImageCount + 1;
+	}
+	else if (presentMode == VK_PRESENT_MODE_FIFO_KHR && presentPolicy == PresentPolicy::VSYNC) {
+		// kiosk/power profile: the minimum keeps memory and queue latency down
+		imageCount = capabilities.minImageCount;
+	}
+	else {
+		// using the minimum number plus one to avoid wainting on the driver
+		// to complete internal operations vefore acquiring another image
+		imageCount = capabilities.minImageCount + 1;
+	}
+
+	// make sure to not exceed the maximum number of images
+	// 0 is a special value, that means that there is no maximum
+	if (capabilities.maxImageCount > 0 &&
+		imageCount > capabilities.maxImageCount) {
+		imageCount = capabilities.maxImageCount;
+	}
+
+	return imageCount;
+}
+
 VkExtent2D TriangleApplication::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
 {
 	if (capabilities.currentExtent.width != UINT32_MAX) {
 		return capabilities.currentExtent;
 	}
 	else {
-		int width, height;
-		// query current size of the framebuffer
-		glfwGetFramebufferSize(window, &width, &height);
-
-		VkExtent2D actualExtent = { static_cast<uint32_t>(width),
-			static_cast<uint32_t>(height) };
+		// the cached framebuffer size (glfwGetFramebufferSize is main
+		// thread only, and this runs on the render thread on recreation)
+		VkExtent2D actualExtent = { static_cast<uint32_t>(framebufferWidth),
+			static_cast<uint32_t>(framebufferHeight) };
 
 		// clamp the value of WIDTH and HEIGHT
 		actualExtent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, actualExtent.width));
@@ -1135,12 +2745,19 @@ VkExtent2D TriangleApplication::chooseSwapExtent(const VkSurfaceCapabilitiesKHR&
 
 void TriangleApplication::createGraphicsPipeline()
 {
-	// Create Shader
-	auto vertShaderCode = readFile("../shadercomp/vert.spv");
-	auto fragShaderCode = readFile("../shadercomp/frag.spv");
+	// the actual setup lives in buildGraphicsPipeline, which the shader
+	// hot reload worker shares to build replacement pipelines off the
+	// render thread
+	buildGraphicsPipeline(graphicsPipeline, pipelineLayout);
+}
 
-	VkShaderModule vertShaderModule = createShaderModule(device, vertShaderCode);
-	VkShaderModule fragShaderModule = createShaderModule(device, fragShaderCode);
+void TriangleApplication::buildGraphicsPipeline(VkPipeline& pipeline, VkPipelineLayout& layout)
+{
+	// Fetch the shader modules from the cache - the SPIR-V is memory-mapped
+	// and the modules are created on first use only, so rebuilding the
+	// pipeline (swap chain recreation) never touches the filesystem again
+	VkShaderModule vertShaderModule = Shader::getModule(device, "../shadercomp/vert.spv");
+	VkShaderModule fragShaderModule = Shader::getModule(device, "../shadercomp/frag.spv");
 
 	// Vertex Shader
 	/////
@@ -1182,13 +2799,28 @@ void TriangleApplication::createGraphicsPipeline()
 	// binds: spacing between data and whether the data is per-vertex or per-instance
 	// attributes descriptions: type of the attributes passed to the vertex shader which
 	//                          binding to load them from and at which offset
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};								// NOTE: Empty because data is hard coded in shader 
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	// point to an array of structs that describe the aforementioned details for loading vertex data
-	vertexInputInfo.vertexBindingDescriptionCount = 0;
-	vertexInputInfo.pVertexBindingDescriptions = nullptr; // Optional
-	vertexInputInfo.vertexAttributeDescriptionCount = 0;
-	vertexInputInfo.pVertexAttributeDescriptions = nullptr; // Optional
+	// binding 0: per-vertex attributes, bindings 1 and 2: the batcher's
+	// per-instance SoA attributes (transforms and colors)
+	auto vertexBinding = Vertex::getBindingDescription();
+	auto instanceBindings = InstanceBatcher::getBindingDescriptions();
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions = {
+		vertexBinding, instanceBindings[0], instanceBindings[1]
+	};
+
+	auto vertexAttributes = Vertex::getAttributeDescriptions();
+	auto instanceAttributes = InstanceBatcher::getAttributeDescriptions();
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions(
+		vertexAttributes.begin(), vertexAttributes.end());
+	attributeDescriptions.insert(attributeDescriptions.end(),
+		instanceAttributes.begin(), instanceAttributes.end());
+
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 	// description what kind of geometry willl be drawn from the vertices and if primitive 
 	// restart should be enabled
@@ -1209,33 +2841,19 @@ void TriangleApplication::createGraphicsPipeline()
 	// if set to True break up _STRIP by using index 0xFFFF or 0xFFFFFFFF
 	inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-	// Setting Viewport
-	// ----------------
-	VkViewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)swapChainExtent.width;
-	viewport.height = (float)swapChainExtent.height;
-	// Depth values must be in the range [0,1]
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	// Setting Scissors
-	// ---------------
-	// define in which regions pixels will actually be stored
-	// any pixels outside the scissor rectangles will be discarded by the rasterizer
-	// Like a Filter (not transform)
-	VkRect2D scissor = {};
-	scissor.offset = { 0, 0 };	// draw entire framebuffer; scissor rectangle covers everything
-	scissor.extent = swapChainExtent;
-
-	// combine viewport state
+	// Viewport and Scissors
+	// ---------------------
+	// both are dynamic state (set per command buffer in
+	// setDynamicPipelineState), so the pipeline does not bake the swap
+	// chain extent anymore - a resize no longer rebuilds the pipeline,
+	// and windows of different sizes share the one pipeline object.
+	// Only the counts are baked here
 	VkPipelineViewportStateCreateInfo viewportState = {};
 	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;	// reference an array to allow multiple viewports on some graphics cards (needs an GPU feature enabled)
+	viewportState.pViewports = nullptr;	// dynamic - provided at record time
 	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;	// reference an array to allow multiple scissor rectangles on some graphics cards
+	viewportState.pScissors = nullptr;	// dynamic - provided at record time
 
 	// Rasterizer
 	// ----------
@@ -1270,8 +2888,9 @@ void TriangleApplication::createGraphicsPipeline()
 	// needs an GPU feature enabled
 	VkPipelineMultisampleStateCreateInfo multisampling = {};
 	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampling.sampleShadingEnable = VK_FALSE;	// Disable multisampling (for now)
-	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampling.sampleShadingEnable = VK_FALSE;	// no per-sample shading - plain MSAA on the edges
+	// matches the render pass color/depth attachments
+	multisampling.rasterizationSamples = msaaSamples;
 	multisampling.minSampleShading = 1.0f; // Optional
 	multisampling.pSampleMask = nullptr; // Optional
 	multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
@@ -1279,8 +2898,19 @@ void TriangleApplication::createGraphicsPipeline()
 	
 	// Depth and Stencil Testing
 	// -------------------------
-	// Not in this Program needed
-	// VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	// static state with no discard/depth-write tricks in the fragment
+	// shader, so the driver can run the test early (early-Z): occluded
+	// fragments are killed before they ever shade
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	// reversed-Z flips the comparison: larger depth = closer
+	depthStencil.depthCompareOp = reversedZ ? VK_COMPARE_OP_GREATER : VK_COMPARE_OP_LESS;
+	// no depth bounds test and no stencil - the formats may not even carry
+	// stencil bits (D32_SFLOAT preferred)
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
 
 	// Color Blending 
 	// --------------
@@ -1330,29 +2960,44 @@ void TriangleApplication::createGraphicsPipeline()
 	// -------------
 	// fill in the dynamic States which can be changed without recreating the pipeline
 	// ignore values of the configuration and need to be specified at drawing time
-	// In this programm substitued by a nullptr
-	VkDynamicState dynamicStates[] = {
+	std::vector<VkDynamicState> dynamicStates = {
 		VK_DYNAMIC_STATE_VIEWPORT,
-		VK_DYNAMIC_STATE_LINE_WIDTH
+		VK_DYNAMIC_STATE_SCISSOR
 	};
+	if (extendedDynamicStateAvailable) {
+		// with extended dynamic state these are record-time too - the
+		// rasterizer/depth values baked above become mere defaults and
+		// every variant (cull on/off, classic vs reversed Z) shares this
+		// one pipeline
+		dynamicStates.push_back(VK_DYNAMIC_STATE_CULL_MODE_EXT);
+		dynamicStates.push_back(VK_DYNAMIC_STATE_FRONT_FACE_EXT);
+		dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT);
+	}
 
 	VkPipelineDynamicStateCreateInfo dynamicState = {};
 	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	dynamicState.dynamicStateCount = 2;
-	dynamicState.pDynamicStates = dynamicStates;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
 
 	// Pipeline Layout
 	// ---------------
 	// Specify uniform variables to be passed to the shader
+	// per-draw data goes through push constants (fast path: recorded
+	// straight into the command buffer, no descriptor involved)
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PushConstantData);
+
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 0; // Optional
-	pipelineLayoutInfo.pSetLayouts = nullptr; // Optional
-	// Push constants 
-	pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-	pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+	// Push constants
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
-	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create pipeline layout!");
 	}
 
@@ -1369,11 +3014,11 @@ void TriangleApplication::createGraphicsPipeline()
 	pipelineInfo.pViewportState = &viewportState;
 	pipelineInfo.pRasterizationState = &rasterizer;
 	pipelineInfo.pMultisampleState = &multisampling;
-	pipelineInfo.pDepthStencilState = nullptr; // Optional
+	pipelineInfo.pDepthStencilState = &depthStencil;
 	pipelineInfo.pColorBlendState = &colorBlending;
-	pipelineInfo.pDynamicState = nullptr; // Optional
+	pipelineInfo.pDynamicState = &dynamicState;
 	// referencing the pipeline Layout
-	pipelineInfo.layout = pipelineLayout;
+	pipelineInfo.layout = layout;
 	// reference to the render pass and the index of the sub pass where 
 	// this graphics pipeline will be used
 	pipelineInfo.renderPass = renderPass;
@@ -1388,13 +3033,156 @@ void TriangleApplication::createGraphicsPipeline()
 	// the Function is designed to take multiple VkGraphicsPipelineCreateInfo objects and ceate multiple VkPipeline objects in a single call
 	// The second argument references an optional VkPipelineCache Object; to use to store and reuse data relevant to pipeline creation across
 	// multiple calls to vkCreateGraphicsPipelines and even across program executions if the cache is stored to a file.
-	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+	if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create graphics pipeline!");
 	}
 
-	// clean up temporary Shader Modules
-	vkDestroyShaderModule(device, fragShaderModule, nullptr);
-	vkDestroyShaderModule(device, vertShaderModule, nullptr);
+	// Note: the shader modules are owned by the Shader cache and stay alive
+	// for reuse; they are destroyed collectively in cleanup()
+}
+
+void TriangleApplication::setDynamicPipelineState(VkCommandBuffer commandBuffer, VkExtent2D extent)
+{
+	// viewport covers the full render target; depth values in [0,1]
+	VkViewport viewport = {};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)extent.width;
+	viewport.height = (float)extent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	// scissor rectangle covers everything - like a filter (not transform)
+	VkRect2D scissor = {};
+	scissor.offset = { 0, 0 };
+	scissor.extent = extent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	if (extendedDynamicStateAvailable) {
+		// the values a pipeline variant family used to differ in; set at
+		// record time, one pipeline object serves them all
+		pfnCmdSetCullMode(commandBuffer, VK_CULL_MODE_BACK_BIT);
+		pfnCmdSetFrontFace(commandBuffer, VK_FRONT_FACE_CLOCKWISE);
+		pfnCmdSetDepthCompareOp(commandBuffer,
+			reversedZ ? VK_COMPARE_OP_GREATER : VK_COMPARE_OP_LESS);
+	}
+}
+
+void TriangleApplication::initShaderHotReload()
+{
+	// the GLSL sources and the SPIR-V the offline scripts compile them to
+	// (an externally written .spv triggers a reload just as well, so the
+	// artists' own compile setups keep working)
+	std::vector<ShaderHotReload::ShaderPair> shaders = {
+		{ "../shader/main.vert", "../shadercomp/vert.spv" },
+		{ "../shader/main.frag", "../shadercomp/frag.spv" },
+	};
+
+	// runs on the watcher thread: build the replacement pipeline against
+	// the warm pipeline cache (the Shader cache re-reads the changed
+	// SPIR-V - it is keyed by mtime) and park it for the frame boundary
+	shaderReloader.init(shaders, [this]() {
+		VkPipeline newPipeline = VK_NULL_HANDLE;
+		VkPipelineLayout newLayout = VK_NULL_HANDLE;
+
+		std::lock_guard<std::mutex> lock(pipelineReloadMutex);
+		buildGraphicsPipeline(newPipeline, newLayout);
+
+		// outrun by an even newer rebuild before the frame boundary hit:
+		// the parked pipeline was never bound, so it can go directly
+		if (pendingPipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(device, pendingPipeline, nullptr);
+			vkDestroyPipelineLayout(device, pendingPipelineLayout, nullptr);
+		}
+		pendingPipeline = newPipeline;
+		pendingPipelineLayout = newLayout;
+	});
+}
+
+void TriangleApplication::applyPendingPipeline()
+{
+	std::lock_guard<std::mutex> lock(pipelineReloadMutex);
+	if (pendingPipeline == VK_NULL_HANDLE) {
+		return;
+	}
+
+	// retire the displaced pipeline like a swap chain recreation does -
+	// frames in flight may still be rendering with it
+	frameGarbage.destroyPipeline(graphicsPipeline);
+	frameGarbage.destroyPipelineLayout(pipelineLayout);
+
+	graphicsPipeline = pendingPipeline;
+	pipelineLayout = pendingPipelineLayout;
+	pendingPipeline = VK_NULL_HANDLE;
+	pendingPipelineLayout = VK_NULL_HANDLE;
+}
+
+void TriangleApplication::createPipelineCache()
+{
+	VkPipelineCacheCreateInfo cacheInfo = {};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+	// try to prime the cache with the data written by a previous run
+	std::vector<char> cacheData;
+	try {
+		cacheData = readFile(PIPELINE_CACHE_FILE);
+	}
+	catch (const std::runtime_error&) {
+		// no cache file yet (e.g. first launch) - start with an empty cache
+	}
+
+	if (cacheData.size() >= 32) {
+		// validate the cache header before handing the blob to the driver;
+		// a cache written by a different device or driver version must be
+		// discarded (the driver would reject or, worse, misparse it)
+		// header layout (all fields uint32_t, little endian):
+		//	length | version | vendorID | deviceID | pipelineCacheUUID (16 byte)
+		uint32_t headerVersion, vendorID, deviceID;
+		memcpy(&headerVersion, cacheData.data() + 4, sizeof(uint32_t));
+		memcpy(&vendorID, cacheData.data() + 8, sizeof(uint32_t));
+		memcpy(&deviceID, cacheData.data() + 12, sizeof(uint32_t));
+
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+		if (headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			vendorID == deviceProperties.vendorID &&
+			deviceID == deviceProperties.deviceID &&
+			memcmp(cacheData.data() + 16, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0) {
+			cacheInfo.initialDataSize = cacheData.size();
+			cacheInfo.pInitialData = cacheData.data();
+		}
+	}
+
+	if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline cache!");
+	}
+}
+
+void TriangleApplication::savePipelineCache()
+{
+	// query the size of the cache data first, then retrieve the blob
+	size_t cacheSize = 0;
+	if (vkGetPipelineCacheData(device, pipelineCache, &cacheSize, nullptr) != VK_SUCCESS ||
+		cacheSize == 0) {
+		// nothing to persist - not an error, the next run simply starts cold
+		return;
+	}
+
+	std::vector<char> cacheData(cacheSize);
+	if (vkGetPipelineCacheData(device, pipelineCache, &cacheSize, cacheData.data()) != VK_SUCCESS) {
+		return;
+	}
+
+	std::ofstream file(PIPELINE_CACHE_FILE, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		// a read only working directory should not take the application down at shutdown
+		std::cerr << "warning: could not write pipeline cache file" << std::endl;
+		return;
+	}
+	file.write(cacheData.data(), cacheSize);
+	file.close();
 }
 
 void TriangleApplication::createRenderPass()
@@ -1402,8 +3190,9 @@ void TriangleApplication::createRenderPass()
 	// Creating a color attachment
 	VkAttachmentDescription colorAttachment = {};
 	colorAttachment.format = swapChainImageFormat;	// set color attachment to swap chain attachment
-	// 1 Sample (since no multisampling)
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	// multisampled when MSAA is on - the scene is then rendered into the
+	// transient color target and attachment 2 receives the resolve
+	colorAttachment.samples = msaaSamples;
 	// set what to do with the data
 	// Load Operations:
 	// VK_ATTACHMENT_LOAD_OP_LOAD - preserve the existing contents of the attachments
@@ -1413,9 +3202,13 @@ void TriangleApplication::createRenderPass()
 	// Store Operations:
 	// VK_ATTACHMENT_STORE_OP_STORE - rendered contents will be stored in memory 
 	//                                and can be read later
-	// VK_ATTACHMENT_STORE_OP_DONT_CARE - contents of the framebuffer will be 
+	// VK_ATTACHMENT_STORE_OP_DONT_CARE - contents of the framebuffer will be
 	//                                    undefined after the rendering operation
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	// with MSAA only the resolved image is read later - not storing the
+	// samples is what lets a tiler keep them on chip
+	colorAttachment.storeOp = msaaSamples != VK_SAMPLE_COUNT_1_BIT
+		? VK_ATTACHMENT_STORE_OP_DONT_CARE
+		: VK_ATTACHMENT_STORE_OP_STORE;
 	// set what to do with the stencil data
 	// nothing will be done with stencil buffer in this programm
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
@@ -1427,7 +3220,49 @@ void TriangleApplication::createRenderPass()
 	// VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL - images to be used as destination for
 	//                                        a memory copy operation
 	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; // specify which layout the image will have before the render pass begins
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // specify to automatically transition to when the render pass finishes
+	// after the render pass the image is either handed to the presentation
+	// engine or (headless) copied out for readback; with MSAA that is the
+	// resolve attachment's job and the multisampled target goes nowhere
+	colorAttachment.finalLayout = msaaSamples != VK_SAMPLE_COUNT_1_BIT
+		? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+		: (headless
+			? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+			: VK_IMAGE_LAYOUT_PRESENT_SRC_KHR); // specify to automatically transition to when the render pass finishes
+
+	// Depth attachment
+	// ----------------
+	// cleared at the start like the color attachment, but never read back
+	// after the pass - DONT_CARE on store lets tiled GPUs keep the depth
+	// buffer entirely on chip
+	VkAttachmentDescription depthAttachment = {};
+	depthAttachment.format = depthFormat;
+	depthAttachment.samples = msaaSamples;	// must match the color attachment
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	// the render pass performs the layout transition itself
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	// Resolve attachment (MSAA only)
+	// ------------------------------
+	// the swap chain image: it is not rendered into, it only receives the
+	// resolved samples at the end of the subpass - a free resolve compared
+	// to a separate vkCmdResolveImage pass with its extra barriers
+	VkAttachmentDescription resolveAttachment = {};
+	resolveAttachment.format = swapChainImageFormat;
+	resolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	// never loaded - the resolve overwrites every pixel
+	resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	resolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	resolveAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	resolveAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	resolveAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	// the resolved image is what presentation/readback consumes
+	resolveAttachment.finalLayout = headless
+		? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+		: VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	// Subpasses and attachment references
 	// -----------------------------------
@@ -1455,6 +3290,20 @@ void TriangleApplication::createRenderPass()
 	//                        but for which the data must be preserved
 	subpass.pColorAttachments = &colorAttachmentRef;
 
+	VkAttachmentReference depthAttachmentRef = {};
+	depthAttachmentRef.attachment = 1;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	// a subpass uses at most one depth/stencil attachment, so no count here
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	// one resolve entry per color attachment (the counts are shared)
+	VkAttachmentReference resolveAttachmentRef = {};
+	resolveAttachmentRef.attachment = 2;
+	resolveAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+		subpass.pResolveAttachments = &resolveAttachmentRef;
+	}
+
 	// dependency 
 	// ---------
 
@@ -1466,19 +3315,29 @@ void TriangleApplication::createRenderPass()
 	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;	// implicit subpass before or after the render pass depending on wheter it is specified in srcSubpass or dstSubpass
 	dependency.dstSubpass = 0;	// subpass which is the first and only one
 	// specify the operation to wait on and the stage in which these opeations occur
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;	// waiting for the color attachment output stage
+	// the early fragment test stages are included: the depth image is
+	// shared across the swap chain images, so the clear of a new pass must
+	// wait until the previous pass is done testing/writing depth
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+		| VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;	// waiting for the color attachment output stage
 	dependency.srcAccessMask = 0;
-	// 
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	//
+	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+		| VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
 	// Render pass
 	// -----------
 	// create Render Object by filling in an array of attachments and subpasses
+	std::vector<VkAttachmentDescription> attachments = { colorAttachment, depthAttachment };
+	if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+		attachments.push_back(resolveAttachment);
+	}
 	VkRenderPassCreateInfo renderPassInfo = {};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = 1;
-	renderPassInfo.pAttachments = &colorAttachment;
+	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+	renderPassInfo.pAttachments = attachments.data();
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
 	// specify an array of dependencies
@@ -1494,60 +3353,178 @@ void TriangleApplication::createRenderPass()
 /// Creates the semaphores.
 /// </summary>
 void TriangleApplication::createSyncObjects()
-{	
-	// allocate sempaphores for each frame
+{
+	// allocate the binary (presentation engine) sempaphores for each frame
 	imageAvailableSemaphore.resize(MAX_FRAMES_IN_FLIGHT);
 	renderFinishedSemaphore.resize(MAX_FRAMES_IN_FLIGHT);
-	inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-	// explicitly initialize to no fence
-	imagesInFlight.resize(swapChainImages.size(), VK_NULL_HANDLE);
+
+	// the timelines themselves live on the device (createLogicalDevice);
+	// here only their bookkeeping is sized. 0 = "never submitted", so the
+	// first wait on each slot falls through - no pre-signaled fences needed
+	frameTimelineValues.assign(MAX_FRAMES_IN_FLIGHT, 0);
+	imageTimelineValues.assign(swapChainImages.size(), 0);
 
 	// create semaphores
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	VkFenceCreateInfo fenceInfo{};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;	// initalize the fences to be initialized in the signal state
-
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
 
 		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore[i]) != VK_SUCCESS ||
-			vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore[i]) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to create synchronization objects for a frame!");
 		}
 	}
 }
 
+void TriangleApplication::createTimestampQueryPool()
+{
+	// timestamps are only meaningful if the graphics queue supports them
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	if (deviceProperties.limits.timestampComputeAndGraphics == VK_FALSE) {
+		// leave the pool as VK_NULL_HANDLE - the GPU phase simply stays empty
+		return;
+	}
+	// conversion factor from timestamp ticks to nanoseconds
+	timestampPeriod = deviceProperties.limits.timestampPeriod;
+
+	// the pool may already exist when the swap chain (and with it the
+	// image count) was recreated
+	if (timestampQueryPool != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+	}
+
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	// two queries (frame start / frame end) per swap chain image
+	queryPoolInfo.queryCount = static_cast<uint32_t>(swapChainImages.size()) * 2;
+
+	if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &timestampQueryPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create timestamp query pool!");
+	}
+}
+
+void TriangleApplication::collectGpuTimestamps(uint32_t imageIndex)
+{
+	if (timestampQueryPool == VK_NULL_HANDLE) {
+		return;
+	}
+
+	// read the two 64 bit timestamps of this image; without the WAIT flag
+	// this returns VK_NOT_READY (e.g. first use of the image) instead of stalling
+	uint64_t timestamps[2];
+	VkResult result = vkGetQueryPoolResults(device, timestampQueryPool,
+		imageIndex * 2, 2,
+		sizeof(timestamps), timestamps, sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT);
+
+	if (result != VK_SUCCESS) {
+		return;
+	}
+
+	// ticks -> nanoseconds -> milliseconds
+	double gpuMilliseconds = double(timestamps[1] - timestamps[0]) * timestampPeriod * 1e-6;
+	frameStats.addSample(FrameStats::PHASE_GPU, gpuMilliseconds);
+
+	// feed the governor's GPU duration prediction
+	pacedGpuFrameMs = pacedGpuFrameMs == 0.0
+		? gpuMilliseconds : pacedGpuFrameMs * 0.9 + gpuMilliseconds * 0.1;
+}
+
 void TriangleApplication::recreateSwapChain()
 {
-	// handle window minimization
-	int width = 0, height = 0;
-	glfwGetFramebufferSize(window, &width, &height);
-	while (width == 0 || height == 0) {
-		glfwGetFramebufferSize(window, &width, &height);
-		glfwWaitEvents();
+	// timed as a whole - recreation latency is one of the numbers the
+	// benchmark harness pins
+	auto recreateStart = std::chrono::steady_clock::now();
+
+	// serialize against the hot reload worker: it must not build from the
+	// Shader cache while the swap chain state it reads is changing
+	std::lock_guard<std::mutex> reloadLock(pipelineReloadMutex);
+
+	// handle window minimization: the main thread reports a 0x0
+	// framebuffer on iconify and the real size again on restore - wait
+	// here (events keep flowing, they are pumped on the main thread)
+	while (framebufferWidth == 0 || framebufferHeight == 0) {
+		drainWindowEvents();
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
 	}
 
-	// wait until resources might be in use 
-	vkDeviceWaitIdle(device);
-	
-	cleanupSwapChain();
+	// no vkDeviceWaitIdle here - frames in flight keep rendering into the
+	// old resources, which go through the deferred-destruction queue and
+	// are destroyed once those frames have drained past their frame waits
+	frameGarbage.destroySwapchain(swapChain);
+	for (auto imageView : swapChainImageViews) {
+		frameGarbage.destroyImageView(imageView);
+	}
+	for (auto framebuffer : swapChainFramebuffers) {
+		frameGarbage.destroyFramebuffer(framebuffer);
+	}
+	if (timestampQueryPool != VK_NULL_HANDLE) {
+		frameGarbage.destroyQueryPool(timestampQueryPool);
+		timestampQueryPool = VK_NULL_HANDLE;
+	}
+	// the MSAA color target and the depth image are sized to the extent -
+	// retire them with the rest
+	if (colorImage != VK_NULL_HANDLE) {
+		frameGarbage.destroyImageView(colorImageView);
+		frameGarbage.destroyImage(colorImage, colorImageAllocation);
+		colorImage = VK_NULL_HANDLE;
+		colorImageView = VK_NULL_HANDLE;
+	}
+	frameGarbage.destroyImageView(depthImageView);
+	frameGarbage.destroyImage(depthImage, depthImageAllocation);
 
-	// (re)-create swap chain it self
+	VkFormat oldFormat = swapChainImageFormat;
+
+	// (re)-create swap chain it self; passes the retiring one as oldSwapchain
 	createSwapChain();
 	// recreate images views since they are based on the swap chain
 	createImageViews();
-	// recreat the renderpass because it depends on the format of the swap chain images
-	createRenderPass();
-	// since scissor and rectangle size is specified re create graphics Pipeline
-	createGraphicsPipeline();
-	// Framebuffer and Command buffer depends on swap chain images
+	// new extent, new MSAA color target and depth image
+	createColorResources();
+	createDepthResources();
+
+	if (swapChainImageFormat != oldFormat) {
+		// only a format change (e.g. monitor switch) invalidates the render
+		// pass - and with it the pipeline, which references it
+		frameGarbage.destroyRenderPass(renderPass);
+		createRenderPass();
+
+		frameGarbage.destroyPipeline(graphicsPipeline);
+		frameGarbage.destroyPipelineLayout(pipelineLayout);
+		createGraphicsPipeline();
+
+		// a pending hot-reload pipeline references the retired render
+		// pass; it was never bound, so it can be dropped directly (the
+		// rebuild above already picked up the newest SPIR-V)
+		if (pendingPipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(device, pendingPipeline, nullptr);
+			vkDestroyPipelineLayout(device, pendingPipelineLayout, nullptr);
+			pendingPipeline = VK_NULL_HANDLE;
+			pendingPipelineLayout = VK_NULL_HANDLE;
+		}
+	}
+	// a pure resize keeps render pass and pipeline: viewport and scissor
+	// are dynamic state, so nothing in the pipeline depends on the extent
+
+	// Framebuffer depends on swap chain images
 	createFramebuffers();
-	createCommandBuffers();
+	// the query pool is sized by the image count, which may have changed
+	createTimestampQueryPool();
+	// the per-frame command buffers are re-recorded every frame anyway,
+	// so nothing to do for them here
+
+	// the image count may differ - old image/timeline-value associations are void
+	imageTimelineValues.assign(swapChainImages.size(), 0);
+
+	recreateTotalMs += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - recreateStart).count();
+	recreateCount++;
 }
 
 void TriangleApplication::cleanupSwapChain()
@@ -1557,20 +3534,455 @@ void TriangleApplication::cleanupSwapChain()
 		vkDestroyFramebuffer(device, framebuffer, nullptr);
 	}
 	
-	// with this function the existing pool can be reused
-	vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-
 	// Destroy Graphics Pipeline
 	vkDestroyPipeline(device, graphicsPipeline, nullptr);
 	// Destroy the Render Pipeline
 	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 	// Destroy the Render Pass Object
 	vkDestroyRenderPass(device, renderPass, nullptr);
-	// destory explicitly created image views 
+	// Destroy the MSAA color target (when MSAA is on)
+	if (colorImage != VK_NULL_HANDLE) {
+		vkDestroyImageView(device, colorImageView, nullptr);
+		vkDestroyImage(device, colorImage, nullptr);
+		bufferAllocator.free(colorImageAllocation);
+	}
+	// Destroy the depth attachment
+	vkDestroyImageView(device, depthImageView, nullptr);
+	vkDestroyImage(device, depthImage, nullptr);
+	bufferAllocator.free(depthImageAllocation);
+	// destory explicitly created image views
 	for (auto imageView : swapChainImageViews) {
 		vkDestroyImageView(device, imageView, nullptr);
 	}
 
-	// clean up the swap chain
-	vkDestroySwapchainKHR(device, swapChain, nullptr);
+	if (headless) {
+		// the offscreen ring images are owned by us, not by a swap chain
+		for (size_t i = 0; i < swapChainImages.size(); i++) {
+			vkDestroyImage(device, swapChainImages[i], nullptr);
+			bufferAllocator.free(offscreenImageAllocations[i]);
+		}
+	}
+	else {
+		// clean up the swap chain
+		vkDestroySwapchainKHR(device, swapChain, nullptr);
+	}
+}
+
+void TriangleApplication::createExtraWindowResources()
+{
+	QueueFamilyIndices familyIndices = findQueueFamilies(physicalDevice);
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (WindowContext& ctx : extraWindows) {
+		if (glfwCreateWindowSurface(instance, ctx.window, nullptr, &ctx.surface) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create window surface!");
+		}
+
+		// all windows present on the one present queue - make sure the new
+		// surface accepts it (on multi-GPU/multi-head setups it might not)
+		VkBool32 presentSupport = VK_FALSE;
+		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice,
+			familyIndices.presentFamily.value(), ctx.surface, &presentSupport);
+		if (presentSupport == VK_FALSE) {
+			throw std::runtime_error("additional window surface rejects the shared present queue!");
+		}
+
+		createWindowSwapChain(ctx);
+		createWindowImageViews(ctx);
+		createWindowColorResources(ctx);
+		createWindowDepthResources(ctx);
+		createWindowFramebuffers(ctx);
+
+		// per-frame acquire semaphores and command buffers (the buffers come
+		// from the frame pools, so the per-frame bulk reset covers them too)
+		ctx.imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+		ctx.commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &ctx.imageAvailableSemaphores[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create synchronization objects for a window!");
+			}
+
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = frameCommandPools[i];
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(device, &allocInfo, &ctx.commandBuffers[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate command buffers!");
+			}
+		}
+	}
+}
+
+void TriangleApplication::createWindowSwapChain(WindowContext& ctx)
+{
+	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice, ctx.surface);
+
+	VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
+	VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+
+	// the shared render pass was built against the first window's format;
+	// a mismatching surface would need its own render pass and pipeline
+	if (surfaceFormat.format != swapChainImageFormat) {
+		throw std::runtime_error("additional window surface format differs from the shared render pass!");
+	}
+
+	// the window's own framebuffer size (cached - see drainWindowEvents),
+	// clamped to the surface limits
+	VkExtent2D extent = swapChainSupport.capabilities.currentExtent;
+	if (extent.width == UINT32_MAX) {
+		extent.width = std::max(swapChainSupport.capabilities.minImageExtent.width,
+			std::min(swapChainSupport.capabilities.maxImageExtent.width, static_cast<uint32_t>(ctx.framebufferWidth)));
+		extent.height = std::max(swapChainSupport.capabilities.minImageExtent.height,
+			std::min(swapChainSupport.capabilities.maxImageExtent.height, static_cast<uint32_t>(ctx.framebufferHeight)));
+	}
+
+	uint32_t imageCount = chooseSwapImageCount(swapChainSupport.capabilities, presentMode);
+
+	VkSwapchainCreateInfoKHR createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	createInfo.surface = ctx.surface;
+	createInfo.minImageCount = imageCount;
+	createInfo.imageFormat = surfaceFormat.format;
+	createInfo.imageColorSpace = surfaceFormat.colorSpace;
+	createInfo.imageExtent = extent;
+	createInfo.imageArrayLayers = 1;
+	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+	uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+
+	if (indices.graphicsFamily != indices.presentFamily) {
+		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		createInfo.queueFamilyIndexCount = 2;
+		createInfo.pQueueFamilyIndices = queueFamilyIndices;
+	}
+	else {
+		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+
+	createInfo.preTransform = swapChainSupport.capabilities.currentTransform;
+	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	createInfo.presentMode = presentMode;
+	createInfo.clipped = VK_TRUE;
+	// on recreation the previous swap chain is handed over so the driver
+	// can keep presenting from it until the new one is ready
+	createInfo.oldSwapchain = ctx.swapChain;
+
+	VkSwapchainKHR newSwapChain;
+	if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &newSwapChain) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create swap chain!");
+	}
+	ctx.swapChain = newSwapChain;
+
+	vkGetSwapchainImagesKHR(device, ctx.swapChain, &imageCount, nullptr);
+	ctx.images.resize(imageCount);
+	vkGetSwapchainImagesKHR(device, ctx.swapChain, &imageCount, ctx.images.data());
+
+	ctx.imageFormat = surfaceFormat.format;
+	ctx.extent = extent;
+}
+
+void TriangleApplication::createWindowImageViews(WindowContext& ctx)
+{
+	ctx.imageViews.resize(ctx.images.size());
+
+	for (size_t i = 0; i < ctx.images.size(); i++) {
+		VkImageViewCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		createInfo.image = ctx.images[i];
+		createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		createInfo.format = ctx.imageFormat;
+		createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		createInfo.subresourceRange.baseMipLevel = 0;
+		createInfo.subresourceRange.levelCount = 1;
+		createInfo.subresourceRange.baseArrayLayer = 0;
+		createInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(device, &createInfo, nullptr, &ctx.imageViews[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create image views!");
+		}
+	}
+}
+
+void TriangleApplication::createWindowColorResources(WindowContext& ctx)
+{
+	// no separate color target in the single-sampled case (same as the
+	// first window)
+	if (msaaSamples == VK_SAMPLE_COUNT_1_BIT) {
+		return;
+	}
+
+	// every window gets its own MSAA color target at its own extent; the
+	// sample count is shared, because the render pass is
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = ctx.extent.width;
+	imageInfo.extent.height = ctx.extent.height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = ctx.imageFormat;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	// transient like the first window's target - resolved within the
+	// pass, never read afterwards
+	imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	imageInfo.samples = msaaSamples;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateImage(device, &imageInfo, nullptr, &ctx.colorImage) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create color image!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, ctx.colorImage, &memRequirements);
+
+	// lazy-memory preference as in createColorResources
+	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	if (bufferAllocator.hasMemoryType(memRequirements.memoryTypeBits,
+			properties | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+		properties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	}
+
+	ctx.colorAllocation = bufferAllocator.allocate(memRequirements, properties, false);
+	vkBindImageMemory(device, ctx.colorImage, ctx.colorAllocation.memory, ctx.colorAllocation.offset);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = ctx.colorImage;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = ctx.imageFormat;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(device, &viewInfo, nullptr, &ctx.colorImageView) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create color image view!");
+	}
+}
+
+void TriangleApplication::createWindowDepthResources(WindowContext& ctx)
+{
+	// every window gets its own depth image: the extents diverge after a
+	// resize, and per-window images keep their render passes independent
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = ctx.extent.width;
+	imageInfo.extent.height = ctx.extent.height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = depthFormat;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	// multisampled and transient when MSAA is on (see createDepthResources)
+	imageInfo.samples = msaaSamples;
+	if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+		imageInfo.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	}
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateImage(device, &imageInfo, nullptr, &ctx.depthImage) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth image!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, ctx.depthImage, &memRequirements);
+
+	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	if (msaaSamples != VK_SAMPLE_COUNT_1_BIT &&
+		bufferAllocator.hasMemoryType(memRequirements.memoryTypeBits,
+			properties | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+		properties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	}
+
+	ctx.depthAllocation = bufferAllocator.allocate(memRequirements, properties, false);
+	vkBindImageMemory(device, ctx.depthImage, ctx.depthAllocation.memory, ctx.depthAllocation.offset);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = ctx.depthImage;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = depthFormat;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(device, &viewInfo, nullptr, &ctx.depthImageView) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create depth image view!");
+	}
+}
+
+void TriangleApplication::createWindowFramebuffers(WindowContext& ctx)
+{
+	ctx.framebuffers.resize(ctx.imageViews.size());
+
+	for (size_t i = 0; i < ctx.imageViews.size(); i++) {
+		// same attachment order as createFramebuffers: with MSAA the swap
+		// chain image is the resolve attachment in slot 2
+		std::vector<VkImageView> attachments;
+		if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+			attachments = { ctx.colorImageView, ctx.depthImageView, ctx.imageViews[i] };
+		}
+		else {
+			attachments = { ctx.imageViews[i], ctx.depthImageView };
+		}
+
+		VkFramebufferCreateInfo framebufferInfo{};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		// the shared render pass - the windows' formats are checked to match
+		framebufferInfo.renderPass = renderPass;
+		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		framebufferInfo.pAttachments = attachments.data();
+		framebufferInfo.width = ctx.extent.width;
+		framebufferInfo.height = ctx.extent.height;
+		framebufferInfo.layers = 1;
+
+		if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &ctx.framebuffers[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create framebuffer!");
+		}
+	}
+}
+
+void TriangleApplication::recreateWindowSwapChain(WindowContext& ctx)
+{
+	// handle window minimization (same cached-size wait as the first
+	// window's recreation path)
+	while (ctx.framebufferWidth == 0 || ctx.framebufferHeight == 0) {
+		drainWindowEvents();
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	// the retiring resources go through the deferred-destruction queue
+	// like the first window's - a resize of a side window must not stall
+	// the frames the main window has in flight
+	for (auto framebuffer : ctx.framebuffers) {
+		frameGarbage.destroyFramebuffer(framebuffer);
+	}
+	for (auto imageView : ctx.imageViews) {
+		frameGarbage.destroyImageView(imageView);
+	}
+	if (ctx.colorImage != VK_NULL_HANDLE) {
+		frameGarbage.destroyImageView(ctx.colorImageView);
+		frameGarbage.destroyImage(ctx.colorImage, ctx.colorAllocation);
+		ctx.colorImage = VK_NULL_HANDLE;
+		ctx.colorImageView = VK_NULL_HANDLE;
+	}
+	frameGarbage.destroyImageView(ctx.depthImageView);
+	frameGarbage.destroyImage(ctx.depthImage, ctx.depthAllocation);
+
+	VkSwapchainKHR oldSwapChain = ctx.swapChain;
+	createWindowSwapChain(ctx);	// hands oldSwapChain over as oldSwapchain
+	if (oldSwapChain != VK_NULL_HANDLE) {
+		frameGarbage.destroySwapchain(oldSwapChain);
+	}
+
+	createWindowImageViews(ctx);
+	createWindowColorResources(ctx);
+	createWindowDepthResources(ctx);
+	createWindowFramebuffers(ctx);
+}
+
+void TriangleApplication::recordWindowCommandBuffer(WindowContext& ctx)
+{
+	VkCommandBuffer commandBuffer = ctx.commandBuffers[currentFrame];
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;	// re-recorded every frame
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to begin recording command buffers!");
+	}
+
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = renderPass;
+	renderPassInfo.framebuffer = ctx.framebuffers[ctx.imageIndex];
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = ctx.extent;
+
+	std::array<VkClearValue, 2> clearValues{};
+	clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+	clearValues[1].depthStencil = { reversedZ ? 0.0f : 1.0f, 0 };
+	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassInfo.pClearValues = clearValues.data();
+
+	// draws are recorded inline: the per-window buffers are trivial, only
+	// the first window's command buffer carries the worker-pool secondary
+	// buffers, the timestamps and (on the GPU-driven path) the culling
+	// dispatch - whose barrier also orders these later draws
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	VkBuffer vertexBuffers[] = {
+		vertexBuffer,
+		gpuCulling ? culledTransformBuffer : instanceTransformBuffer,
+		gpuCulling ? culledColorBuffer : instanceColorBuffer
+	};
+	VkDeviceSize offsets[] = {
+		0,
+		currentFrame * sizeof(glm::vec4) * MAX_INSTANCES,
+		currentFrame * sizeof(glm::vec3) * MAX_INSTANCES
+	};
+	vkCmdBindVertexBuffers(commandBuffer, 0, 3, vertexBuffers, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+
+	// the window's own extent - the shared pipeline adapts via dynamic state
+	setDynamicPipelineState(commandBuffer, ctx.extent);
+
+	uint32_t dynamicOffset = static_cast<uint32_t>(currentFrame * uniformStride);
+
+	PushConstantData push{};
+	push.tint = glm::vec4(1.0f);
+
+	if (gpuCulling) {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+			0, 1, &descriptorSet, 1, &dynamicOffset);
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+			0, sizeof(push), &push);
+
+		vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer,
+			currentFrame * INDIRECT_SLICE_SIZE, 1, sizeof(VkDrawIndexedIndirectCommand));
+	}
+	else {
+		VkPipeline boundPipeline = VK_NULL_HANDLE;
+		for (const InstanceBatcher::Batch& batch : instanceBatcher.getBatches()) {
+			if (batch.pipeline != boundPipeline) {
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, batch.pipeline);
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+					0, 1, &descriptorSet, 1, &dynamicOffset);
+				vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+					0, sizeof(push), &push);
+				boundPipeline = batch.pipeline;
+			}
+
+			vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()),
+				batch.instanceCount, 0, 0, batch.firstInstance);
+		}
+	}
+
+	vkCmdEndRenderPass(commandBuffer);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record command buffer!");
+	}
 }
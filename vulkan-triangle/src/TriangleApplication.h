@@ -8,10 +8,19 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+//Include GLM
+#define GLM_FORCE_RADIANS
+// Vulkan clips z to [0,1] (OpenGL uses [-1,1]); without this the depth
+// range the projection produces would not match what the depth test sees
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
 #include <iostream>
 #include <stdexcept>
-#include <algorithm> 
+#include <algorithm>
 #include <vector>
+#include <array>
 #include <cstring>
 #include <cstdlib>
 #include <cstdint> // Necessary for UINT32_MAX
@@ -20,30 +29,149 @@
 #include <functional>
 #include <map>
 #include <fstream>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
 
 // Application Header
-#include "shader.h""
+#include "shader.h"
+#include "frameStats.h"
+#include "recordingWorkerPool.h"
+#include "bufferAllocator.h"
+#include "instanceBatcher.h"
+#include "textureStreamer.h"
+#include "descriptorAllocator.h"
+#include "shaderHotReload.h"
+#include "frameGarbage.h"
+#include "queueTimeline.h"
+#include "windowEventQueue.h"
 
 
 /* constants window sizes */
 const int WIDTH = 800;
 const int HEIGHT = 600;
 
+/* validation layers in debug builds only. constexpr, so every
+ * enableValidationLayers branch - messenger setup, layer lists, the
+ * whole callback path - folds away at compile time in release builds */
+#ifdef NDEBUG
+constexpr bool enableValidationLayers = false;
+#else
+constexpr bool enableValidationLayers = true;
+#endif
+
+/* how often one validation message id is printed before it is muted */
+const uint32_t DEBUG_MESSAGE_REPEAT_LIMIT = 8;
+
 /* max amount of frames to be processed*/
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+/* capacity of the per-frame instance buffers (objects per frame) */
+const uint32_t MAX_INSTANCES = 1024;
+
+/* per-frame slice of the indirect buffer; one VkDrawIndexedIndirectCommand
+ * padded up so the per-frame descriptor offsets stay aligned to
+ * minStorageBufferOffsetAlignment (256 covers every implementation) */
+const VkDeviceSize INDIRECT_SLICE_SIZE = 256;
+
+/* file the pipeline cache data is persisted to between runs */
+const std::string PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+
+/* file the winning physical device identity is cached in, so later
+ * startups can skip scoring every device again */
+const std::string DEVICE_CACHE_FILE = "device_selection.bin";
+
 // struct for Queue families
 struct QueueFamilyIndices {
 	std::optional<uint32_t> graphicsFamily;
-	std::optional<uint32_t> presentFamily;		// ensure that the device can present 
+	std::optional<uint32_t> presentFamily;		// ensure that the device can present
 												// images to the surface
 
+	// dedicated families for async work; both are optional - on devices
+	// without dedicated families they fall back to the graphics family,
+	// so isComplete() does not depend on them
+	std::optional<uint32_t> transferFamily;		// preferably transfer-only (DMA engine)
+	std::optional<uint32_t> computeFamily;		// preferably compute without graphics
+
 	bool isComplete() {
-		return graphicsFamily.has_value() && 
+		return graphicsFamily.has_value() &&
 			presentFamily.has_value();
 	}
 };
 
+/**
+ * Present policy profiles. They steer which present mode
+ * chooseSwapPresentMode() picks and how many swap chain images
+ * createSwapChain() asks for - switching profiles at runtime goes
+ * through the regular swap chain recreation path
+ */
+enum class PresentPolicy {
+	LOW_LATENCY,	// mailbox preferred: newest frame wins, no tearing
+	VSYNC,			// FIFO: capped at refresh rate (kiosk / power saving)
+	UNCAPPED		// immediate preferred: raw throughput, tearing accepted
+};
+
+/**
+ * Vertex format fed to the vertex shader
+ * (position and color, interleaved in one buffer)
+ */
+struct Vertex {
+	glm::vec2 pos;
+	glm::vec3 color;
+
+	/* describes at which rate to load data from memory throughout the vertices */
+	static VkVertexInputBindingDescription getBindingDescription() {
+		VkVertexInputBindingDescription bindingDescription = {};
+		bindingDescription.binding = 0;
+		bindingDescription.stride = sizeof(Vertex);
+		// move to the next data entry after each vertex (not each instance)
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return bindingDescription;
+	}
+
+	/* describes how to extract the two attributes from a vertex */
+	static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions = {};
+
+		// position: vec2 -> VK_FORMAT_R32G32_SFLOAT
+		attributeDescriptions[0].binding = 0;
+		attributeDescriptions[0].location = 0;
+		attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+		attributeDescriptions[0].offset = offsetof(Vertex, pos);
+
+		// color: vec3 -> VK_FORMAT_R32G32B32_SFLOAT
+		attributeDescriptions[1].binding = 0;
+		attributeDescriptions[1].location = 1;
+		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attributeDescriptions[1].offset = offsetof(Vertex, color);
+
+		return attributeDescriptions;
+	}
+};
+
+/**
+ * Per-frame uniform data streamed to the shaders through the uniform
+ * ring buffer (std140 layout - mat4 members are 16 byte aligned by
+ * themselves, so no explicit alignas is needed here)
+ */
+struct UniformBufferObject {
+	glm::mat4 model;
+	glm::mat4 view;
+	glm::mat4 proj;
+};
+
+/**
+ * Tiny per-draw data recorded directly into the command buffer via
+ * vkCmdPushConstants - no buffer, no descriptor, no synchronization.
+ * Must stay small: only 128 bytes are guaranteed by the spec
+ */
+struct PushConstantData {
+	glm::vec4 tint;
+};
+
 /**
  * Three kinds of property compatiblities
  * to check
@@ -62,9 +190,184 @@ class TriangleApplication {
 public:
 	void run();
 
-	// flag that need to be sent for update framebuffer explicit
+	// flag that need to be sent for update framebuffer explicit. Owned by
+	// the render thread - GLFW resize callbacks do not set it directly
+	// anymore, they queue an event and drainWindowEvents() raises it
 	bool framebufferResized = false;
-	
+
+	/**
+	 * Headless mode: no GLFW window, no surface, no swap chain. Rendering
+	 * goes into an offscreen image ring and submission runs back-to-back
+	 * limited only by the frame waits - for batch generating frames on
+	 * surface-less compute nodes. Set before calling run()
+	 */
+	bool headless = false;
+	/* number of frames to render before run() returns in headless mode */
+	uint32_t headlessFrameCount = 1000;
+
+	/**
+	 * Reads the rendered pixels of an offscreen image back to the host
+	 * (headless mode only; waits for the device to go idle first)
+	 * @param imageIndex	index into the offscreen image ring
+	 * @return tightly packed pixel data in the offscreen image format
+	 */
+	std::vector<uint8_t> readbackImage(uint32_t imageIndex);
+
+	/**
+	 * Switches the present policy at runtime. The swap chain is recreated
+	 * on the next frame through the usual recreation path, so the switch
+	 * is live and does not stall rendering
+	 * @param policy
+	 */
+	void setPresentPolicy(PresentPolicy policy) {
+		if (presentPolicy != policy) {
+			presentPolicy = policy;
+			framebufferResized = true;	// piggyback on the recreation path
+		}
+	}
+
+	PresentPolicy getPresentPolicy() const { return presentPolicy; }
+
+	/**
+	 * GPU-driven submission: a compute shader culls the frame's instances
+	 * and compacts the survivors plus the draw's instanceCount into an
+	 * indirect buffer, so the CPU records the same tiny command buffer no
+	 * matter how many objects are submitted. Disable to fall back to the
+	 * CPU-built instanced draws
+	 */
+	bool gpuCulling = true;
+
+	/**
+	 * Reversed-Z depth: the projection maps the near plane to depth 1 and
+	 * the far plane to depth 0, the depth test compares with GREATER and
+	 * the buffer clears to 0. With a floating point depth format this
+	 * spends the float precision where the scene actually is instead of
+	 * wasting it near the camera - z-fighting on distant geometry all but
+	 * disappears. Disable for the classic LESS/clear-to-1 convention.
+	 * Set before calling run()
+	 */
+	bool reversedZ = true;
+
+	/**
+	 * Multisample anti-aliasing: the scene is rendered into a transient
+	 * multisampled color target and resolved into the swap chain image
+	 * within the render pass (no extra pass, no extra barrier). The
+	 * sample count is the maximum the device supports for both color and
+	 * depth; the multisampled targets are marked transient and backed by
+	 * lazily allocated memory where available, so tile-based GPUs keep
+	 * them entirely on chip and never spill the samples to RAM. Disable
+	 * for single-sampled rendering. Set before calling run()
+	 */
+	bool msaa = true;
+
+	/**
+	 * Number of windows to drive. All windows share the one VkDevice,
+	 * pipeline and geometry; each gets its own GLFW window, surface and
+	 * swap chain. The per-window submissions go out in a single
+	 * vkQueueSubmit and all swap chains are presented through one
+	 * vkQueuePresentKHR call, so the windows stay in cross-window sync
+	 * (multi-display walls ran as N processes before, N-uplicating the
+	 * device and pipeline memory). Set before calling run()
+	 */
+	uint32_t windowCount = 1;
+
+	/**
+	 * Queues a resize event for the additional window with the given
+	 * handle (called from the GLFW resize callback on the main thread);
+	 * the render thread picks it up and recreates the swap chain
+	 * @param handle	the GLFW window that changed size
+	 * @param width		new framebuffer width
+	 * @param height	new framebuffer height
+	 */
+	void notifyWindowResized(GLFWwindow* handle, int width, int height);
+
+	/**
+	 * Queues a resize event for the first window (called from the GLFW
+	 * resize callback on the main thread)
+	 * @param width		new framebuffer width
+	 * @param height	new framebuffer height
+	 */
+	void notifyFramebufferResized(int width, int height);
+
+	/**
+	 * Latency governor: instead of racing ahead and blocking inside
+	 * vkAcquireNextImageKHR with a full swap chain of queued frames
+	 * (under FIFO that is several frames of input-to-photon latency),
+	 * the CPU sleeps at the start of drawFrame() so the frame's work
+	 * finishes just in time for the present deadline. The predictions
+	 * come from the frame interval, the measured CPU work and the GPU
+	 * timestamp queries
+	 */
+	bool latencyGovernor = true;
+
+	/**
+	 * Shader hot reload: a watcher thread recompiles edited shaders and
+	 * rebuilds the graphics pipeline in the background; the new pipeline
+	 * is swapped in at the next frame boundary and the old one destroyed
+	 * once the frames in flight have drained. Editing a shader no longer
+	 * needs an app restart. Set before calling run()
+	 */
+	bool hotReloadShaders = true;
+	/**
+	 * The latency knob: safety margin in milliseconds between predicted
+	 * frame completion and the deadline. Lower = less latency, higher =
+	 * more protection against missed presents on noisy systems
+	 */
+	float pacingMarginMs = 1.0f;
+
+	/**
+	 * Sets the runtime filter for validation messages. Messages outside
+	 * the mask are still counted but never formatted or written - the
+	 * messenger itself stays subscribed to everything, so the filter can
+	 * be widened again at runtime (e.g. per deployment config)
+	 * @param severities	severity bits that get printed
+	 * @param types			message type bits that get printed
+	 */
+	void setDebugMessageFilter(VkDebugUtilsMessageSeverityFlagsEXT severities,
+			VkDebugUtilsMessageTypeFlagsEXT types) {
+		debugSeverityFilter = severities;
+		debugTypeFilter = types;
+	}
+
+	/**
+	 * Number of validation messages received per severity
+	 * @param severityIndex		0 verbose, 1 info, 2 warning, 3 error
+	 */
+	uint64_t getDebugMessageCount(int severityIndex) const {
+		return debugMessageCounts[severityIndex];
+	}
+
+	/**
+	 * Stops the windowed main loop after this many frames (0 = run until
+	 * the window is closed) - gives the benchmark harness deterministic
+	 * windowed runs. Headless runs are bounded by headlessFrameCount
+	 */
+	uint32_t frameLimit = 0;
+
+	/**
+	 * Benchmark hook: force a swap chain recreation every N frames
+	 * (0 = never), so the recreation latency can be measured under
+	 * repeatable conditions instead of waiting for a user to resize
+	 */
+	uint32_t benchRecreateEvery = 0;
+
+	/* read access to the per-phase timing rings (percentiles etc.) */
+	const FrameStats& getFrameStats() const { return frameStats; }
+
+	/* turns the periodic CSV dump on stdout on/off (the benchmark harness
+	 * owns stdout for its JSON and reads the rings directly) */
+	void setStatsCsvDump(bool enabled) { frameStats.csvDump = enabled; }
+
+	/* time from entering run() until the first frame was submitted */
+	double getInitToFirstFrameMs() const { return initToFirstFrameMs; }
+	/* wall time spent inside the frame loop */
+	double getFrameLoopMs() const { return frameLoopMs; }
+	/* frames rendered in total (windowed or headless) */
+	uint64_t getFramesRendered() const { return framesRendered; }
+	/* accumulated recreateSwapChain() time and invocation count */
+	double getRecreateTotalMs() const { return recreateTotalMs; }
+	uint32_t getRecreateCount() const { return recreateCount; }
+
 private:
 	// -------------------------
 	// Class Memebers
@@ -73,9 +376,61 @@ private:
 	/* Function to store a reference to the actual Window */
 	GLFWwindow* window;
 
+	/**
+	 * Main-to-render-thread event plumbing: the main thread owns GLFW and
+	 * pumps its events continuously, the callbacks push records here and
+	 * the render thread drains them at the top of every frame
+	 * (see windowEventQueue.h)
+	 */
+	WindowEventQueue windowEvents;
+	/* render loop liveness - the main thread pumps events until this drops */
+	std::atomic<bool> renderThreadRunning{ false };
+	/* last framebuffer size reported for the first window. Written on the
+	 * main thread only before the render thread starts, afterwards only by
+	 * drainWindowEvents() on the render thread - the render thread must
+	 * never call glfwGetFramebufferSize itself (main thread only in GLFW) */
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+
+	/* active present policy (see setPresentPolicy) */
+	PresentPolicy presentPolicy = PresentPolicy::LOW_LATENCY;
+
 	VkInstance instance;
 	/* Tell Vulkan about callback function */
 	VkDebugUtilsMessengerEXT debugMessenger;
+
+	/**
+	 * Runtime validation message filter and statistics. The callback
+	 * counts every message (cheap), prints only those passing the filter,
+	 * and mutes a message id after DEBUG_MESSAGE_REPEAT_LIMIT repeats -
+	 * so staging builds keep real warnings visible instead of drowning
+	 * them in per-frame spam. Guarded by a mutex: the layers may call
+	 * back from any thread
+	 */
+	VkDebugUtilsMessageSeverityFlagsEXT debugSeverityFilter =
+		VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
+		VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+	VkDebugUtilsMessageTypeFlagsEXT debugTypeFilter =
+		VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
+		VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+		VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+	std::mutex debugStatsMutex;
+	/* received messages by severity: verbose, info, warning, error */
+	uint64_t debugMessageCounts[4] = {};
+	/* messages dropped by the filter or the repeat limit */
+	uint64_t debugMessagesSuppressed = 0;
+	/* occurrences per message id (for the repeat limit) */
+	std::unordered_map<int32_t, uint32_t> debugMessageOccurrences;
+
+	/* maps a severity bit to an index into debugMessageCounts */
+	static int debugSeverityIndex(VkDebugUtilsMessageSeverityFlagBitsEXT severity) {
+		switch (severity) {
+		case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT:	return 0;
+		case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT:		return 1;
+		case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT:	return 2;
+		default:												return 3;
+		}
+	}
 	/* Abstract type of surface to present rendered images */
 	VkSurfaceKHR surface;
 
@@ -92,11 +447,19 @@ private:
 	VkQueue graphicsQueue;
 	/* Presentation Queue */
 	VkQueue presentQueue;
+	/* Queue for staging copies; a dedicated transfer family if the device has
+	 * one, otherwise the graphics queue (uploads then serialize on rendering) */
+	VkQueue transferQueue;
+	/* Queue for async compute work; dedicated compute family if available */
+	VkQueue computeQueue;
 
 	/* Stores the VkSwapchainKHR object */
-	VkSwapchainKHR swapChain;
-	/* Stores the handles of the VkImages */
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+	/* Stores the handles of the VkImages
+	 * (in headless mode these are the offscreen ring images) */
 	std::vector<VkImage> swapChainImages;
+	/* backing memory of the offscreen images (headless mode only) */
+	std::vector<BufferAllocator::Allocation> offscreenImageAllocations;
 	/* Stores the Swap Chaine Image Format */
 	VkFormat swapChainImageFormat;
 	/* Swap Chain Extent Object */
@@ -104,8 +467,18 @@ private:
 
 	/* Stores the command pool which mangages the memory */
 	VkCommandPool commandPool;
-	/* Stores a List of command Buffers for every image in the swap chain,
-	 * Note: they will be automatically freed when their command pool is 
+	/* Transient pool on the transfer family for one-shot staging copies */
+	VkCommandPool transferCommandPool = VK_NULL_HANDLE;
+	/* Transient pool on the compute family for one-shot compute dispatches */
+	VkCommandPool computeCommandPool = VK_NULL_HANDLE;
+	/* Ring of command pools, one per frame in flight. Each frame resets its
+	 * whole pool with vkResetCommandPool (cheap, bulk recycling of the
+	 * backing memory) and re-records only its own command buffer, so dynamic
+	 * scene content never forces a vkDeviceWaitIdle + full re-record */
+	std::vector<VkCommandPool> frameCommandPools;
+	/* One primary command buffer per frame in flight, allocated from the
+	 * matching pool in frameCommandPools and re-recorded every frame.
+	 * Note: they will be automatically freed when their command pool is
 	 * destroyed, there is no explicit cleanup necessary! */
 	std::vector<VkCommandBuffer> commandBuffers;
 
@@ -119,6 +492,34 @@ private:
 	 */
 	std::vector<VkFramebuffer> swapChainFramebuffers;
 
+	/**
+	 * Depth attachment: one device-local image at swap chain extent,
+	 * shared by all swap chain images (only one render pass instance
+	 * writes it at a time - the subpass dependency serializes them).
+	 * Early-Z kills occluded fragments before they shade, so overdraw
+	 * stops costing fragment work
+	 */
+	VkImage depthImage = VK_NULL_HANDLE;
+	BufferAllocator::Allocation depthImageAllocation;
+	VkImageView depthImageView = VK_NULL_HANDLE;
+	/* picked once by findDepthFormat() (D32_SFLOAT preferred) */
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+
+	/* samples per pixel; queried from the device when msaa is enabled,
+	 * VK_SAMPLE_COUNT_1_BIT otherwise */
+	VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	/**
+	 * The multisampled color target the scene is rendered into when MSAA
+	 * is on (the swap chain image then only receives the resolve). Like
+	 * the depth image it is shared by all framebuffers and transient:
+	 * the samples live and die within one render pass instance, so on
+	 * tile-based GPUs its lazily allocated memory is never committed
+	 */
+	VkImage colorImage = VK_NULL_HANDLE;
+	BufferAllocator::Allocation colorImageAllocation;
+	VkImageView colorImageView = VK_NULL_HANDLE;
+
 	/**
 	 * Render Pass Object to store Information about Framebuffers
 	 */
@@ -132,29 +533,291 @@ private:
 
 	VkPipeline graphicsPipeline;
 
+	/**
+	 * Shader hot reload state. The watcher's worker thread builds the
+	 * replacement pipeline (buildGraphicsPipeline) and parks it in the
+	 * pending slot; applyPendingPipeline() swaps it in at the next frame
+	 * boundary. The mutex serializes the worker's builds against the
+	 * render thread's (recreateSwapChain) and guards the pending slot -
+	 * it also makes the Shader module cache safe to touch from both
+	 */
+	ShaderHotReload shaderReloader;
+	std::mutex pipelineReloadMutex;
+	VkPipeline pendingPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout pendingPipelineLayout = VK_NULL_HANDLE;
+
+	/**
+	 * Pool allocator all buffer memory is suballocated from
+	 * (large blocks, so mesh counts are not limited by the driver's
+	 * allocation cap)
+	 */
+	BufferAllocator bufferAllocator;
+
+	/* whether VK_EXT_memory_budget was enabled on the device */
+	bool memoryBudgetAvailable = false;
+
+	/**
+	 * Streaming texture loader: IO thread for decoding, uploads on the
+	 * transfer queue, mip generation on the graphics queue, LRU eviction
+	 * under the VRAM budget below. The triangle's shaders do not sample
+	 * textures yet - the streamer runs as its own subsystem until they do
+	 */
+	TextureStreamer textureStreamer;
+
+	/* VRAM the streamer may keep resident before evicting (bytes) */
+	VkDeviceSize textureBudgetBytes = 256 * 1024 * 1024;
+
+	/* Vertex buffer in device local memory (uploaded through staging) */
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
+	BufferAllocator::Allocation vertexBufferAllocation;
+	/* Index buffer in device local memory (uploaded through staging) */
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	BufferAllocator::Allocation indexBufferAllocation;
+
+	/**
+	 * Descriptor infrastructure: the layout cache deduplicates identical
+	 * set layouts across pipelines, the allocator hands out sets from
+	 * growable pool arenas (persistent ones plus per-frame transient
+	 * arenas that are whole-pool reset in beginFrame). All layouts and
+	 * sets below come from these two
+	 */
+	DescriptorLayoutCache descriptorLayoutCache;
+	DescriptorAllocator descriptorAllocator;
+
+	/* whether VK_KHR_push_descriptor was enabled on the device (lets hot
+	 * paths push descriptors into the command buffer instead of
+	 * allocating sets; unused until the texture bindings land) */
+	bool pushDescriptorsAvailable = false;
+
+	/* whether VK_EXT_extended_dynamic_state was enabled on the device.
+	 * With it, cull mode, front face and depth compare are set at record
+	 * time instead of baked into the pipeline - a whole family of
+	 * pipeline variants collapses into one object (smaller pipeline
+	 * cache, fewer compiles at startup) */
+	bool extendedDynamicStateAvailable = false;
+	/* the extension's device-level entry points, loaded once */
+	PFN_vkCmdSetCullModeEXT pfnCmdSetCullMode = nullptr;
+	PFN_vkCmdSetFrontFaceEXT pfnCmdSetFrontFace = nullptr;
+	PFN_vkCmdSetDepthCompareOpEXT pfnCmdSetDepthCompareOp = nullptr;
+
+	/* Layout of the per-frame uniform binding (dynamic uniform buffer);
+	 * owned by the layout cache */
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	/* The single descriptor set; per-frame selection happens through the
+	 * dynamic offset at bind time, so no per-frame sets are needed */
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+	/**
+	 * Uniform ring buffer: one slice per frame in flight in a single
+	 * host-visible buffer, persistently mapped through the allocator -
+	 * updating a frame's uniforms is a plain memcpy, no vkMapMemory per
+	 * frame. The CPU only ever writes the slice whose frame wait has been
+	 * waited on, so no extra synchronization is needed
+	 */
+	VkBuffer uniformBuffer = VK_NULL_HANDLE;
+	BufferAllocator::Allocation uniformBufferAllocation;
+	/* size of one ring slice (sizeof(UniformBufferObject) rounded up to
+	 * minUniformBufferOffsetAlignment) */
+	VkDeviceSize uniformStride = 0;
+
+	/**
+	 * Sorts the frame's objects into (pipeline, mesh) buckets so identical
+	 * meshes collapse into single instanced draws
+	 */
+	InstanceBatcher instanceBatcher;
+
+	/**
+	 * Per-instance attribute buffers (structure of arrays: transforms and
+	 * colors separately). Like the uniform ring: one slice per frame in
+	 * flight, host visible and persistently mapped, rewritten per frame
+	 */
+	VkBuffer instanceTransformBuffer = VK_NULL_HANDLE;
+	BufferAllocator::Allocation instanceTransformAllocation;
+	VkBuffer instanceColorBuffer = VK_NULL_HANDLE;
+	BufferAllocator::Allocation instanceColorAllocation;
+
+	/**
+	 * GPU culling resources: the compacted instance buffers the compute
+	 * shader writes survivors into (device local - never touched by the
+	 * CPU) and the indirect buffer holding one draw command per frame
+	 * slice, whose instanceCount the shader bumps atomically
+	 */
+	VkBuffer culledTransformBuffer = VK_NULL_HANDLE;
+	BufferAllocator::Allocation culledTransformAllocation;
+	VkBuffer culledColorBuffer = VK_NULL_HANDLE;
+	BufferAllocator::Allocation culledColorAllocation;
+	/* host visible: the CPU resets instanceCount to 0 each frame */
+	VkBuffer indirectBuffer = VK_NULL_HANDLE;
+	BufferAllocator::Allocation indirectAllocation;
+
+	/* compute pipeline running the culling shader (layout owned by the
+	 * layout cache, sets by the descriptor allocator) */
+	VkDescriptorSetLayout cullDescriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline cullPipeline = VK_NULL_HANDLE;
+	/* one set per frame in flight (each points at that frame's slices) */
+	std::vector<VkDescriptorSet> cullDescriptorSets;
+
+	/* push constants fed to the culling shader (matches cull.comp) */
+	struct CullPushConstants {
+		uint32_t instanceCount = 0;
+		float pad = 0.0f;
+		glm::vec2 viewMin;
+		glm::vec2 viewMax;
+	};
+
+	/**
+	 * Pipeline cache the driver fills with compilation results.
+	 * Persisted to disk in cleanup() and loaded again in createPipelineCache(),
+	 * so repeated launches and swap chain recreations hit warm caches instead
+	 * of recompiling the SPIR-V from scratch
+	 */
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
 	// Variable to keep track of the current frame
 	size_t currentFrame = 0;
 
 	/**
-	  * Semaphores a set for each frame
+	  * Binary semaphores, a set for each frame: the presentation engine
+	  * only accepts these (vkAcquireNextImageKHR and vkQueuePresentKHR
+	  * cannot signal or wait on timelines), so acquire and present keep
+	  * their per-frame pairs
 	  */
 
 	std::vector<VkSemaphore> imageAvailableSemaphore;	// signal that an image has been acquired and is ready for rendering
 	std::vector<VkSemaphore> renderFinishedSemaphore;	// signal that rendering has finished and presentation can happen
 
 	/**
-	 * Fences for CPU-GPU synchronization
+	 * Timeline-based CPU-GPU synchronization (see queueTimeline.h): every
+	 * frame submit signals the next value on the graphics timeline and
+	 * the host waits on stored values - no fence arrays, no resets
+	 */
+	QueueTimeline graphicsTimeline;
+	/* the transfer queue's timeline: the texture streamer's copies signal
+	 * it and the mip-blit submits wait on the copy's value - a cross-queue
+	 * dependency expressed as a plain wait-value */
+	QueueTimeline transferTimeline;
+	/* the timeline value each frame in flight's submit signals (0 = slot
+	 * never submitted, the wait falls through) */
+	std::vector<uint64_t> frameTimelineValues;
+	// the value of the last submit rendering into each swap chain image
+	std::vector<uint64_t> imageTimelineValues;
+
+	/**
+	 * Central deferred-destruction queue: retired handles (swap chain
+	 * recreation, hot-reloaded pipelines, window resizes) are enqueued
+	 * here and destroyed once MAX_FRAMES_IN_FLIGHT further frames have
+	 * passed their frame wait in drawFrame() - at that point no submitted
+	 * work can reference them. Replaces every mid-run vkDeviceWaitIdle
+	 */
+	FrameGarbage frameGarbage;
+
+	/**
+	 * Everything one additional window owns. The first window lives in the
+	 * long-standing single-window members above; windows 1..N-1 each get
+	 * one of these and share the device, render pass, pipeline, geometry
+	 * and uniform state with it. Viewport and scissor are dynamic state,
+	 * so the shared pipeline covers windows of any size
+	 */
+	struct WindowContext {
+		GLFWwindow* window = nullptr;
+		VkSurfaceKHR surface = VK_NULL_HANDLE;
+		VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+		std::vector<VkImage> images;
+		std::vector<VkImageView> imageViews;
+		std::vector<VkFramebuffer> framebuffers;
+		VkFormat imageFormat = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent = {};
+		/* per-window depth attachment (windows resize independently) */
+		VkImage depthImage = VK_NULL_HANDLE;
+		BufferAllocator::Allocation depthAllocation;
+		VkImageView depthImageView = VK_NULL_HANDLE;
+		/* per-window multisampled color target (unused when MSAA is off;
+		 * the sample count is shared - the render pass is) */
+		VkImage colorImage = VK_NULL_HANDLE;
+		BufferAllocator::Allocation colorAllocation;
+		VkImageView colorImageView = VK_NULL_HANDLE;
+		/* one acquire semaphore per frame in flight */
+		std::vector<VkSemaphore> imageAvailableSemaphores;
+		/* one command buffer per frame in flight (from the frame pools) */
+		std::vector<VkCommandBuffer> commandBuffers;
+		/* image acquired for the frame being built */
+		uint32_t imageIndex = 0;
+		/* whether the acquire succeeded and the window submits this frame */
+		bool activeThisFrame = false;
+		bool framebufferResized = false;
+		/* last framebuffer size from the resize events (same ownership
+		 * rules as the first window's framebufferWidth/Height) */
+		int framebufferWidth = 0;
+		int framebufferHeight = 0;
+	};
+	/* windows 1..N-1 (empty in the single-window and headless cases) */
+	std::vector<WindowContext> extraWindows;
+
+	/**
+	 * Rolling per-phase frame timing statistics (CPU + GPU),
+	 * dumped periodically to stdout as CSV
+	 */
+	FrameStats frameStats;
+
+	/* --- benchmark bookkeeping (see the getters in the public section) --- */
+	std::chrono::steady_clock::time_point runStart;
+	double initToFirstFrameMs = 0.0;
+	double frameLoopMs = 0.0;
+	uint64_t framesRendered = 0;
+	double recreateTotalMs = 0.0;
+	uint32_t recreateCount = 0;
+
+	/* called at the end of each frame: counts frames and captures the
+	 * init-to-first-frame time on the first one */
+	void noteFrameRendered() {
+		if (framesRendered == 0) {
+			initToFirstFrameMs = std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now() - runStart).count();
+		}
+		framesRendered++;
+	}
+
+	/**
+	 * Persistent worker threads that record the draw batches of a frame
+	 * into secondary command buffers (per-thread command pools), which the
+	 * primary buffer then executes with vkCmdExecuteCommands
 	 */
-	std::vector<VkFence> inFlightFences;
-	// track for each swap chain image if a frame in flight is currently using it
-	std::vector<VkFence> imagesInFlight;
+	RecordingWorkerPool recordingWorkers;
+
+	/**
+	 * Query pool with two timestamp queries per swap chain image
+	 * (written at the start and end of each command buffer)
+	 */
+	VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+	/* nanoseconds per timestamp tick (device dependent) */
+	float timestampPeriod = 0.0f;
+
+	/**
+	 * Latency governor state: exponential moving averages (ms) of the
+	 * frame interval, the CPU-side frame work and the GPU frame duration
+	 * (fed from the timestamp queries), plus the reference time points
+	 */
+	double pacedFrameIntervalMs = 0.0;
+	double pacedCpuWorkMs = 0.0;
+	double pacedGpuFrameMs = 0.0;
+	std::chrono::steady_clock::time_point pacedLastFrameStart{};
+	std::chrono::steady_clock::time_point pacedWorkStart{};
 
 	// -------------------------
 	// Functions
 	// -------------------------
 
+	/**
+	 * Initializes the GLFW library itself. Split out of initWindow() so
+	 * instance creation (which asks GLFW for the required extensions) can
+	 * start on a worker thread while the window is still being created
+	 */
+	void initGlfw();
+
 	/**
 	 * Initialize the Window
+	 * (main thread only - a GLFW requirement)
 	 */
 	void initWindow();
 
@@ -164,10 +827,25 @@ private:
 	void initVulkan();
 
 	/**
-	 * Main Loop iterates until Window ist closed
+	 * Main Loop iterates until Window ist closed. Windowed mode splits in
+	 * two: this thread keeps pumping GLFW events (a GLFW requirement and
+	 * what keeps the window responsive while the GPU is busy) and the
+	 * frame loop runs on a dedicated render thread
 	 */
 	void mainLoop();
 
+	/**
+	 * The render thread's frame loop: drains the window event queue and
+	 * calls drawFrame() until the window closes or frameLimit is reached
+	 */
+	void renderLoop();
+
+	/**
+	 * Applies the main thread's queued window events (render thread):
+	 * raises the resize flags and updates the cached framebuffer sizes
+	 */
+	void drainWindowEvents();
+
 	/**
 	 * Deallocate the resources
 	 */
@@ -184,10 +862,95 @@ private:
 	 */
 	void createImageViews();
 
+	/**
+	 * Picks the depth attachment format: D32_SFLOAT preferred (a float
+	 * format is what makes reversed-Z pay off), with the packed
+	 * depth/stencil formats as fallback
+	 */
+	VkFormat findDepthFormat();
+
+	/**
+	 * Creates the depth image at swap chain extent plus its view. The
+	 * layout transition to DEPTH_STENCIL_ATTACHMENT_OPTIMAL happens in
+	 * the render pass (initialLayout UNDEFINED), so no explicit barrier
+	 * is needed here
+	 */
+	void createDepthResources();
+
+	/**
+	 * Queries the highest sample count the device supports for both
+	 * color and depth framebuffer attachments - the MSAA targets and the
+	 * depth image share one sample count
+	 */
+	VkSampleCountFlagBits getMaxUsableSampleCount();
+
+	/**
+	 * Creates the multisampled color target at swap chain extent plus
+	 * its view. Transient and lazily allocated where the device offers
+	 * it (see the member doc). No-op when MSAA is off
+	 */
+	void createColorResources();
+
 	/**
 	 * Function that calls all the SwapChain Help Functions
 	 */
 	void createSwapChain();
+
+	/**
+	 * Creates the additional windows' Vulkan resources: surface, swap
+	 * chain, image views, framebuffers, per-frame acquire semaphores and
+	 * command buffers. Runs at the end of initVulkan, when the shared
+	 * render pass, pipeline and command pools already exist (the GLFW
+	 * windows themselves are created in initWindow)
+	 */
+	void createExtraWindowResources();
+
+	/**
+	 * Creates (or, with an existing swap chain handed over as
+	 * oldSwapchain, recreates) one additional window's swap chain and
+	 * fetches its images. The per-window variant of createSwapChain
+	 * @param ctx	the window's context
+	 */
+	void createWindowSwapChain(WindowContext& ctx);
+
+	/* per-window variants of createImageViews/createColorResources/
+	 * createDepthResources/createFramebuffers */
+	void createWindowImageViews(WindowContext& ctx);
+	void createWindowColorResources(WindowContext& ctx);
+	void createWindowDepthResources(WindowContext& ctx);
+	void createWindowFramebuffers(WindowContext& ctx);
+
+	/**
+	 * Recreates one additional window's swap chain after a resize or an
+	 * out-of-date acquire/present
+	 * @param ctx	the window's context
+	 */
+	void recreateWindowSwapChain(WindowContext& ctx);
+
+	/**
+	 * Records one additional window's command buffer for the frame: the
+	 * same scene into the window's framebuffer. Draws are recorded
+	 * directly (the secondary-buffer worker machinery is not duplicated
+	 * per window); on the GPU-driven path the culling dispatch recorded
+	 * into the first window's command buffer covers these draws too -
+	 * its memory barrier orders all later commands in the submission
+	 * @param ctx	the window's context
+	 */
+	void recordWindowCommandBuffer(WindowContext& ctx);
+
+	/**
+	 * Headless counterpart of createSwapChain(): creates the offscreen
+	 * image ring the frames are rendered into and fills the swap chain
+	 * members (images, format, extent) so the rest of the code is
+	 * oblivious to the missing swap chain
+	 */
+	void createOffscreenTarget();
+
+	/**
+	 * Headless counterpart of drawFrame(): submits back-to-back, paced
+	 * only by the frame waits - no acquire, no present
+	 */
+	void drawFrameHeadless();
 		
 	/**
 	 * Creates a surface to draw on
@@ -212,10 +975,123 @@ private:
 	void createCommandPool();
 
 	/**
-	 * Allocate command buffers and records drawing commands
+	 * Allocate one command buffer per frame in flight
+	 * (recording happens per frame in recordCommandBuffer)
 	 */
 	void createCommandBuffers();
 
+	/**
+	 * Records the current frame's command buffer (drawing into the
+	 * framebuffer of the acquired swap chain image). The frame's pool has
+	 * to be reset before this is called
+	 * @param imageIndex	index of the acquired swap chain image
+	 */
+	void recordCommandBuffer(uint32_t imageIndex);
+
+	/**
+	 * Allocates and begins a one-shot command buffer from the given pool
+	 * (used for staging copies on the transfer queue and one-off compute work)
+	 * @param pool
+	 */
+	VkCommandBuffer beginSingleTimeCommands(VkCommandPool pool);
+
+	/**
+	 * Ends, submits and waits for a one-shot command buffer, then frees it
+	 * @param commandBuffer	buffer returned by beginSingleTimeCommands
+	 * @param queue			queue matching the pool the buffer came from
+	 * @param pool
+	 */
+	void endSingleTimeCommands(VkCommandBuffer commandBuffer, VkQueue queue, VkCommandPool pool);
+
+	/**
+	 * Records a buffer-to-buffer copy on the transfer queue, so uploads
+	 * overlap rendering on devices with a dedicated transfer family
+	 * @param srcBuffer
+	 * @param dstBuffer
+	 * @param size
+	 */
+	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+
+	/**
+	 * Creates a VkBuffer and backs it with a suballocation from the pool
+	 * allocator (shared concurrently between the graphics and transfer
+	 * families when they differ)
+	 * @param size
+	 * @param usage			buffer usage flags
+	 * @param properties	required memory property flags
+	 * @param buffer		out: created buffer
+	 * @param allocation	out: backing suballocation
+	 */
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+		VkBuffer& buffer, BufferAllocator::Allocation& allocation);
+
+	/**
+	 * Creates the device local vertex buffer and uploads the vertex data
+	 * through a staging buffer on the transfer queue
+	 */
+	void createVertexBuffer();
+
+	/**
+	 * Creates the device local index buffer and uploads the index data
+	 * through a staging buffer on the transfer queue
+	 */
+	void createIndexBuffer();
+
+	/**
+	 * Creates the descriptor set layout: a single dynamic uniform buffer
+	 * binding. Dynamic, so one descriptor set serves every frame (and
+	 * every object) - only the offset changes at bind time
+	 */
+	void createDescriptorSetLayout();
+
+	/**
+	 * Creates the persistently mapped uniform ring buffer
+	 * (MAX_FRAMES_IN_FLIGHT slices, each aligned to
+	 * minUniformBufferOffsetAlignment)
+	 */
+	void createUniformBuffer();
+
+	/**
+	 * Creates the descriptor pool and allocates the single descriptor set
+	 * pointing at the uniform ring buffer
+	 */
+	void createDescriptorSets();
+
+	/**
+	 * Writes the current frame's uniform data into its ring slice
+	 * (plain memcpy into the persistent mapping)
+	 * @param frame		frame in flight index
+	 */
+	void updateUniformBuffer(uint32_t frame);
+
+	/**
+	 * Creates the per-frame instance attribute buffers
+	 * (MAX_INSTANCES objects per frame slice)
+	 */
+	void createInstanceBuffers();
+
+	/**
+	 * Submits the frame's objects to the batcher, sorts them into batches
+	 * and uploads the SoA instance data into this frame's buffer slices
+	 * @param frame		frame in flight index
+	 */
+	void buildFrameInstances(uint32_t frame);
+
+	/**
+	 * Creates the GPU culling resources: the compacted instance buffers,
+	 * the indirect draw buffer, the compute pipeline running cull.comp
+	 * and the per-frame descriptor sets wiring them together
+	 */
+	void createCullResources();
+
+	/**
+	 * Records the culling dispatch for the current frame into the given
+	 * command buffer, including the barrier that makes the compacted
+	 * data and indirect command visible to the draw
+	 * @param commandBuffer		the frame's primary command buffer
+	 */
+	void recordCullDispatch(VkCommandBuffer commandBuffer);
+
 	/**
 	 * Function that will be called from the main loop to put the triangle
 	 * on the screen
@@ -227,16 +1103,51 @@ private:
 
 	/**
 	 * Rates the device Suitabiliy
+	 * Weighs device type, texture limits, device local heap size,
+	 * resizable BAR style heaps and dedicated async queue families;
+	 * returns 0 for devices that cannot run the application at all
 	 * @param device
 	 */
 	int rateDeviceSuitability(VkPhysicalDevice device);
 
+	/**
+	 * Identity of the physical device picked by a previous run,
+	 * persisted in DEVICE_CACHE_FILE
+	 */
+	struct CachedDeviceIdentity {
+		uint32_t vendorID = 0;
+		uint32_t deviceID = 0;
+		uint8_t uuid[VK_UUID_SIZE] = {};
+	};
+
+	/**
+	 * Reads the cached device identity from disk
+	 * @param identity	out parameter
+	 * @return false if no valid cache file exists
+	 */
+	bool readCachedDeviceIdentity(CachedDeviceIdentity& identity);
+
+	/**
+	 * Persists the identity of the selected device for the next startup
+	 * @param device
+	 */
+	void writeCachedDeviceIdentity(VkPhysicalDevice device);
+
 	/**
 	 * Function to poplate the SwapChainSupportDetails Struct
 	 * @param device 
 	 */
 	SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
+	/**
+	 * Overload taking an explicit surface (the additional windows each
+	 * bring their own); the single-parameter version forwards here with
+	 * the first window's surface
+	 * @param device
+	 * @param querySurface
+	 */
+	SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR querySurface);
+
 	/**
 	 * Base device suitability checks
 	 * Evaluation function for graphic cars
@@ -274,7 +1185,9 @@ private:
 	std::vector<const char*> getRequiredExtensions();
 
 	/**
-	 * Creates instance (connection between app and Vulkan Library)
+	 * Creates instance (connection between app and Vulkan Library) -
+	 * delegates to the shared bootstrap library, which caches the
+	 * extension/layer enumeration across all callers
 	 */
 	void createInstance();
 
@@ -296,10 +1209,20 @@ private:
 
 	/**
 	 * Choose the presentation modes (conditions for "swapping" images to the screen)
+	 * according to the active present policy
 	 * @param availablePresentModes
 	 */
 	VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
 
+	/**
+	 * Chooses the number of swap chain images for the given present mode
+	 * (mailbox needs a spare image to actually drop frames into; FIFO gets
+	 * by with the minimum to save memory and latency)
+	 * @param capabilities
+	 * @param presentMode
+	 */
+	uint32_t chooseSwapImageCount(const VkSurfaceCapabilitiesKHR& capabilities, VkPresentModeKHR presentMode);
+
 	/**
 	 * Swap extent (resolution of images in swap chain)
 	 * Always exavtly equal to the resolution of the window that we're drawing to
@@ -312,6 +1235,55 @@ private:
 	 */
 	void createGraphicsPipeline();
 
+	/**
+	 * Builds a graphics pipeline (and its layout) from the current SPIR-V
+	 * on disk against the pipeline cache. Shared by createGraphicsPipeline()
+	 * and the hot reload worker; every caller after init must hold
+	 * pipelineReloadMutex (the Shader module cache is not thread safe)
+	 * @param pipeline	receives the new pipeline
+	 * @param layout	receives the new pipeline layout
+	 */
+	void buildGraphicsPipeline(VkPipeline& pipeline, VkPipelineLayout& layout);
+
+	/**
+	 * Sets the dynamic pipeline state for a command buffer: viewport and
+	 * scissor from the given extent, plus cull mode, front face and depth
+	 * compare when VK_EXT_extended_dynamic_state is available. Called
+	 * once per (secondary) command buffer after the render pass begins -
+	 * dynamic state survives pipeline binds within the buffer
+	 * @param commandBuffer
+	 * @param extent		render target extent (differs per window)
+	 */
+	void setDynamicPipelineState(VkCommandBuffer commandBuffer, VkExtent2D extent);
+
+	/**
+	 * Starts the shader hot reload watcher; its rebuild callback builds
+	 * the replacement pipeline on the watcher thread and parks it in the
+	 * pending slot
+	 */
+	void initShaderHotReload();
+
+	/**
+	 * Swaps in a pending hot-reloaded pipeline, if one is waiting. Called
+	 * at the frame boundary right after the frame wait; the displaced
+	 * pipeline goes through the deferred-destruction queue, so frames in
+	 * flight keep rendering with it until they have drained
+	 */
+	void applyPendingPipeline();
+
+	/**
+	 * Creates the pipeline cache object and primes it with the cache data
+	 * of a previous run (if a cache file exists and was written by the
+	 * same device/driver)
+	 */
+	void createPipelineCache();
+
+	/**
+	 * Retrieves the pipeline cache data from the driver and writes it to
+	 * disk, so the next launch can prime its cache with it
+	 */
+	void savePipelineCache();
+
 	/**
 	 * Create a Renderpass object
 	 * Specifies how many color and depth buffer attachments there be,
@@ -325,12 +1297,31 @@ private:
 	 */
 	void createSyncObjects();
 
+	/**
+	 * Creates the timestamp query pool used for GPU frame timing
+	 * (skipped if the device reports no timestamp support)
+	 */
+	void createTimestampQueryPool();
+
+	/**
+	 * Reads back the GPU timestamps of the given swap chain image and
+	 * feeds the resulting GPU frame time into frameStats
+	 * @param imageIndex
+	 */
+	void collectGpuTimestamps(uint32_t imageIndex);
+
+	/**
+	 * Updates the pacing averages and sleeps until just-in-time before
+	 * the frame's work has to start. Called at the top of drawFrame()
+	 */
+	void applyLatencyGovernor();
+
 	/** 
 	 * Recreates the Swap Chain.
 	 */
 	void recreateSwapChain();
 
-	/** 
+	/**
 	 * Cleans up swap chain parts
 	 */
 	void cleanupSwapChain();
@@ -363,11 +1354,44 @@ private:
 	 *	@return boolean, that indicates if the Vulkan call that triffered the validation message should be aborted
 	 *					if true - call aborted with VK_ERROR_CALIDATION_FAILED_EXT
 	 */
-	static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, 
-														VkDebugUtilsMessageTypeFlagsEXT messageType, 
-														const VkDebugUtilsMessengerCallbackDataEXT * pCallbackData, 
+	static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+														VkDebugUtilsMessageTypeFlagsEXT messageType,
+														const VkDebugUtilsMessengerCallbackDataEXT * pCallbackData,
 														void * pUserData) {
+		auto app = reinterpret_cast<TriangleApplication*>(pUserData);
+		if (app == nullptr) {
+			// no filtering state available - old behavior
+			std::cerr << "validation layer:" << pCallbackData->pMessage << std::endl;
+			return VK_FALSE;
+		}
+
+		std::lock_guard<std::mutex> lock(app->debugStatsMutex);
+
+		// every message is counted, whether it gets printed or not - the
+		// counters are the cheap instrumentation surface, formatting is
+		// the expensive part this path avoids
+		app->debugMessageCounts[debugSeverityIndex(messageSeverity)]++;
+
+		// runtime severity/type filter
+		if (!(messageSeverity & app->debugSeverityFilter) ||
+			!(messageType & app->debugTypeFilter)) {
+			app->debugMessagesSuppressed++;
+			return VK_FALSE;
+		}
+
+		// rate limit: a message id that fires every frame is printed a
+		// handful of times, then only counted
+		uint32_t occurrences = ++app->debugMessageOccurrences[pCallbackData->messageIdNumber];
+		if (occurrences > DEBUG_MESSAGE_REPEAT_LIMIT) {
+			app->debugMessagesSuppressed++;
+			return VK_FALSE;
+		}
+
 		std::cerr << "validation layer:" << pCallbackData->pMessage << std::endl;
+		if (occurrences == DEBUG_MESSAGE_REPEAT_LIMIT) {
+			std::cerr << "validation layer: (message id " << pCallbackData->messageIdNumber
+				<< " reached its repeat limit - further occurrences are only counted)" << std::endl;
+		}
 
 		return VK_FALSE;
 	}
@@ -0,0 +1,466 @@
+#pragma once
+
+//Include Vulkan
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <stdexcept>
+#include <cstdint>
+#include <iostream>
+
+/**
+ * Suballocating pool allocator for buffer memory.
+ *
+ * Drivers cap the number of live VkDeviceMemory objects (often at 4096)
+ * and every vkAllocateMemory call is slow, so per-buffer allocations do
+ * not scale to thousands of meshes. This allocator grabs large blocks
+ * (64 MB by default) per memory type and hands out aligned slices of
+ * them via a first-fit free list; freeing a slice merges it with its
+ * free neighbours so the block does not fragment permanently.
+ *
+ * Blocks are segregated by resource linearity: buffers (and linearly
+ * tiled images) never share a block with optimally tiled images. Vulkan
+ * forbids a linear and a non-linear resource within the same
+ * bufferImageGranularity page of one allocation, and since the blocks of
+ * the two sets are separate VkDeviceMemory objects the rule can never be
+ * violated - no per-allocation granularity padding is needed.
+ *
+ * Host-visible blocks are persistently mapped once at block creation -
+ * a suballocation exposes its own pointer into the mapping, so staging
+ * writes never pay for vkMapMemory/vkUnmapMemory per upload.
+ *
+ * Per-frame transients (uploads that only live until the frame's fence
+ * is waited on) come from linear arenas instead of the free lists: one
+ * bump-pointer arena per frame in flight, reset wholesale in beginFrame.
+ * A transient allocation therefore costs a pointer increment and never
+ * touches (or fragments) the long-lived blocks.
+ *
+ * When VK_EXT_memory_budget is enabled the allocator compares its heap
+ * usage against the OS-reported budget whenever it opens a new block and
+ * warns before the driver would start evicting; without the extension it
+ * falls back to the raw heap sizes.
+ */
+class BufferAllocator {
+public:
+	/* default size of one backing VkDeviceMemory block */
+	static const VkDeviceSize BLOCK_SIZE = 64 * 1024 * 1024;
+
+	/* size of one per-frame linear arena chunk */
+	static const VkDeviceSize ARENA_CHUNK_SIZE = 4 * 1024 * 1024;
+
+	/* one suballocation: the backing memory plus offset/size of the slice */
+	struct Allocation {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		/* pointer into the persistent mapping (host-visible memory only) */
+		void* mapped = nullptr;
+		/* internal: which block/range the slice came from */
+		uint32_t blockIndex = UINT32_MAX;
+	};
+
+	void init(VkPhysicalDevice physicalDevice, VkDevice device,
+			uint32_t framesInFlight, bool memoryBudgetEnabled) {
+		this->physicalDevice = physicalDevice;
+		this->device = device;
+		this->memoryBudgetEnabled = memoryBudgetEnabled;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+		// one linear arena per frame in flight; chunks are opened lazily
+		frameArenas.resize(framesInFlight);
+	}
+
+	/**
+	 * Resets the given frame's linear arena. Call once per frame, after
+	 * the frame's fence has been waited on - every transient allocation
+	 * handed out for this frame index becomes invalid here
+	 * @param frame		frame in flight index
+	 */
+	void beginFrame(uint32_t frame) {
+		frameArenas[frame].currentChunk = 0;
+		frameArenas[frame].cursor = 0;
+	}
+
+	/**
+	 * Bump-allocates host-visible transient memory from the frame's linear
+	 * arena. The slice is valid until beginFrame(frame) runs again; free()
+	 * is a no-op on arena allocations
+	 * @param frame			frame in flight index
+	 * @param requirements	from vkGetBufferMemoryRequirements
+	 */
+	Allocation allocateTransient(uint32_t frame, const VkMemoryRequirements& requirements) {
+		FrameArena& arena = frameArenas[frame];
+
+		while (arena.currentChunk < arena.chunks.size()) {
+			ArenaChunk& chunk = arena.chunks[arena.currentChunk];
+
+			VkDeviceSize alignedOffset = (arena.cursor + requirements.alignment - 1) & ~(requirements.alignment - 1);
+			if ((requirements.memoryTypeBits & (1 << chunk.memoryType)) &&
+				alignedOffset + requirements.size <= chunk.size) {
+				arena.cursor = alignedOffset + requirements.size;
+
+				Allocation allocation;
+				allocation.memory = chunk.memory;
+				allocation.offset = alignedOffset;
+				allocation.size = requirements.size;
+				allocation.mapped = static_cast<char*>(chunk.mapped) + alignedOffset;
+				// blockIndex stays UINT32_MAX: free() ignores arena slices
+				return allocation;
+			}
+
+			// chunk exhausted (or wrong memory type) - move to the next one
+			arena.currentChunk++;
+			arena.cursor = 0;
+		}
+
+		// no chunk had room - open a new one (oversized transients get a
+		// chunk of their own size)
+		ArenaChunk chunk;
+		chunk.size = requirements.size > ARENA_CHUNK_SIZE ? requirements.size : ARENA_CHUNK_SIZE;
+		chunk.memoryType = findMemoryType(requirements.memoryTypeBits,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = chunk.size;
+		allocInfo.memoryTypeIndex = chunk.memoryType;
+
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &chunk.memory) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate arena chunk!");
+		}
+		vkMapMemory(device, chunk.memory, 0, VK_WHOLE_SIZE, 0, &chunk.mapped);
+
+		heapUsed[memoryProperties.memoryTypes[chunk.memoryType].heapIndex] += chunk.size;
+		checkBudget();
+
+		arena.chunks.push_back(chunk);
+		arena.currentChunk = static_cast<uint32_t>(arena.chunks.size() - 1);
+		arena.cursor = requirements.size;
+
+		Allocation allocation;
+		allocation.memory = chunk.memory;
+		allocation.offset = 0;
+		allocation.size = requirements.size;
+		allocation.mapped = chunk.mapped;
+		return allocation;
+	}
+
+	/**
+	 * Suballocates memory satisfying the given requirements and property
+	 * flags; opens a new block when no existing block has a fitting range
+	 * @param requirements	from vkGetBufferMemoryRequirements
+	 * @param properties	e.g. VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	 * @param linear		true for buffers, false for optimally tiled
+	 *						images - selects the block set (see the
+	 *						bufferImageGranularity note above)
+	 */
+	Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+			bool linear) {
+		uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+
+		// first fit over the existing blocks of this memory type and linearity
+		for (uint32_t b = 0; b < blocks.size(); b++) {
+			if (blocks[b].memoryType != memoryType || blocks[b].linear != linear) {
+				continue;
+			}
+			Allocation allocation;
+			if (allocateFromBlock(b, requirements, allocation)) {
+				return allocation;
+			}
+		}
+
+		// no block had room - open a new one (oversized requests get a
+		// dedicated block of their own size)
+		VkDeviceSize blockSize = requirements.size > BLOCK_SIZE ? requirements.size : BLOCK_SIZE;
+		uint32_t b = createBlock(memoryType, blockSize, properties, linear);
+
+		Allocation allocation;
+		if (!allocateFromBlock(b, requirements, allocation)) {
+			throw std::runtime_error("failed to suballocate from a fresh memory block!");
+		}
+		return allocation;
+	}
+
+	/* returns a slice to its block's free list, merging adjacent free ranges */
+	void free(const Allocation& allocation) {
+		if (allocation.blockIndex == UINT32_MAX) {
+			return;
+		}
+		Block& block = blocks[allocation.blockIndex];
+
+		// insert the range sorted by offset
+		FreeRange range{ allocation.offset, allocation.size };
+		size_t pos = 0;
+		while (pos < block.freeList.size() && block.freeList[pos].offset < range.offset) {
+			pos++;
+		}
+		block.freeList.insert(block.freeList.begin() + pos, range);
+
+		// merge with the successor, then with the predecessor
+		if (pos + 1 < block.freeList.size() &&
+			block.freeList[pos].offset + block.freeList[pos].size == block.freeList[pos + 1].offset) {
+			block.freeList[pos].size += block.freeList[pos + 1].size;
+			block.freeList.erase(block.freeList.begin() + pos + 1);
+		}
+		if (pos > 0 &&
+			block.freeList[pos - 1].offset + block.freeList[pos - 1].size == block.freeList[pos].offset) {
+			block.freeList[pos - 1].size += block.freeList[pos].size;
+			block.freeList.erase(block.freeList.begin() + pos);
+		}
+	}
+
+	/* releases all backing blocks and arenas (all suballocations must be unused) */
+	void destroy() {
+		for (Block& block : blocks) {
+			if (block.mapped != nullptr) {
+				vkUnmapMemory(device, block.memory);
+			}
+			vkFreeMemory(device, block.memory, nullptr);
+		}
+		blocks.clear();
+
+		for (FrameArena& arena : frameArenas) {
+			for (ArenaChunk& chunk : arena.chunks) {
+				vkUnmapMemory(device, chunk.memory);
+				vkFreeMemory(device, chunk.memory, nullptr);
+			}
+		}
+		frameArenas.clear();
+	}
+
+	/**
+	 * Warns on stderr when a heap's usage approaches its budget. With
+	 * VK_EXT_memory_budget the OS-reported budget and usage (which include
+	 * other processes) are used; otherwise the allocator's own bookkeeping
+	 * is compared against the raw heap size
+	 */
+	void checkBudget() {
+		if (memoryBudgetEnabled) {
+			VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+			budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+			VkPhysicalDeviceMemoryProperties2 properties2{};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+			properties2.pNext = &budget;
+			vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties2);
+
+			for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; heap++) {
+				if (budget.heapBudget[heap] > 0 &&
+					budget.heapUsage[heap] > budget.heapBudget[heap] / 10 * 9) {
+					std::cerr << "memory warning: heap " << heap << " usage "
+						<< (budget.heapUsage[heap] >> 20) << " MB of "
+						<< (budget.heapBudget[heap] >> 20)
+						<< " MB budget - eviction imminent" << std::endl;
+				}
+			}
+			return;
+		}
+
+		for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; heap++) {
+			if (heapUsed[heap] > memoryProperties.memoryHeaps[heap].size / 10 * 9) {
+				std::cerr << "memory warning: heap " << heap << " usage "
+					<< (heapUsed[heap] >> 20) << " MB of "
+					<< (memoryProperties.memoryHeaps[heap].size >> 20)
+					<< " MB heap size" << std::endl;
+			}
+		}
+	}
+
+	/**
+	 * Prints per-block occupancy and fragmentation statistics to stdout.
+	 * Fragmentation is 1 - largestFreeRange/totalFree: 0 means all free
+	 * space is one contiguous range, values near 1 mean the free space
+	 * is shattered and large allocations will force new blocks
+	 */
+	void dumpStatistics() {
+		std::cout << "buffer allocator: " << blocks.size() << " block(s)" << std::endl;
+		for (size_t b = 0; b < blocks.size(); b++) {
+			const Block& block = blocks[b];
+
+			VkDeviceSize freeBytes = 0;
+			VkDeviceSize largestFree = 0;
+			for (const FreeRange& range : block.freeList) {
+				freeBytes += range.size;
+				if (range.size > largestFree) {
+					largestFree = range.size;
+				}
+			}
+
+			double fragmentation = 0.0;
+			if (freeBytes > 0) {
+				fragmentation = 1.0 - (double)largestFree / (double)freeBytes;
+			}
+
+			std::cout << "  block " << b
+				<< ": type " << block.memoryType
+				<< (block.linear ? " (buffers)" : " (images)")
+				<< ", " << ((block.size - freeBytes) >> 10) << "/" << (block.size >> 10) << " KB used"
+				<< ", " << block.freeList.size() << " free range(s)"
+				<< ", fragmentation " << (int)(fragmentation * 100.0) << "%" << std::endl;
+		}
+
+		for (size_t f = 0; f < frameArenas.size(); f++) {
+			VkDeviceSize capacity = 0;
+			for (const ArenaChunk& chunk : frameArenas[f].chunks) {
+				capacity += chunk.size;
+			}
+			std::cout << "  frame arena " << f << ": "
+				<< frameArenas[f].chunks.size() << " chunk(s), "
+				<< (capacity >> 10) << " KB capacity" << std::endl;
+		}
+	}
+
+	/**
+	 * Checks whether a memory type matching the type filter and property
+	 * flags exists at all - for callers that want to try an optional
+	 * property (e.g. lazily allocated) and fall back instead of throwing
+	 * @param typeFilter	bitmask of allowed memory types
+	 * @param properties	required property flags
+	 */
+	bool hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+			if ((typeFilter & (1 << i)) &&
+				(memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Finds a memory type index matching the type filter and property flags
+	 * @param typeFilter	bitmask of allowed memory types
+	 * @param properties	required property flags
+	 */
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+			if ((typeFilter & (1 << i)) &&
+				(memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				return i;
+			}
+		}
+		throw std::runtime_error("failed to find suitable memory type!");
+	}
+
+private:
+	/* a free range inside a block (offset/size, kept sorted by offset) */
+	struct FreeRange {
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	};
+
+	/* one chunk of a per-frame linear arena (host visible, always mapped) */
+	struct ArenaChunk {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		uint32_t memoryType = 0;
+		void* mapped = nullptr;
+	};
+
+	/* bump-pointer arena for one frame in flight */
+	struct FrameArena {
+		std::vector<ArenaChunk> chunks;
+		uint32_t currentChunk = 0;
+		VkDeviceSize cursor = 0;
+	};
+
+	/* one backing VkDeviceMemory block and its free list */
+	struct Block {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		uint32_t memoryType = 0;
+		/* true: buffers, false: optimally tiled images */
+		bool linear = true;
+		/* persistent mapping (host-visible blocks only) */
+		void* mapped = nullptr;
+		std::vector<FreeRange> freeList;
+	};
+
+	/* allocates one VkDeviceMemory block and maps it if host visible */
+	uint32_t createBlock(uint32_t memoryType, VkDeviceSize size, VkMemoryPropertyFlags properties,
+			bool linear) {
+		Block block;
+		block.size = size;
+		block.memoryType = memoryType;
+		block.linear = linear;
+		block.freeList.push_back({ 0, size });
+
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = memoryType;
+
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate memory block!");
+		}
+
+		if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+			// map once, keep mapped for the block's lifetime
+			vkMapMemory(device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped);
+		}
+
+		heapUsed[memoryProperties.memoryTypes[memoryType].heapIndex] += size;
+		checkBudget();
+
+		blocks.push_back(block);
+		return static_cast<uint32_t>(blocks.size() - 1);
+	}
+
+	/* first-fit search over one block's free list, honoring alignment */
+	bool allocateFromBlock(uint32_t blockIndex, const VkMemoryRequirements& requirements, Allocation& allocation) {
+		Block& block = blocks[blockIndex];
+
+		for (size_t i = 0; i < block.freeList.size(); i++) {
+			FreeRange& range = block.freeList[i];
+
+			// round the range start up to the required alignment
+			VkDeviceSize alignedOffset = (range.offset + requirements.alignment - 1) & ~(requirements.alignment - 1);
+			VkDeviceSize padding = alignedOffset - range.offset;
+
+			if (range.size < padding + requirements.size) {
+				continue;
+			}
+
+			allocation.memory = block.memory;
+			allocation.offset = alignedOffset;
+			allocation.size = requirements.size;
+			allocation.blockIndex = blockIndex;
+			if (block.mapped != nullptr) {
+				allocation.mapped = static_cast<char*>(block.mapped) + alignedOffset;
+			}
+
+			// shrink/split the free range; the alignment padding stays free
+			VkDeviceSize rangeEnd = range.offset + range.size;
+			VkDeviceSize allocationEnd = alignedOffset + requirements.size;
+
+			if (padding > 0 && allocationEnd < rangeEnd) {
+				// split into a leading and a trailing free range
+				range.size = padding;
+				block.freeList.insert(block.freeList.begin() + i + 1,
+					{ allocationEnd, rangeEnd - allocationEnd });
+			}
+			else if (padding > 0) {
+				range.size = padding;
+			}
+			else if (allocationEnd < rangeEnd) {
+				range.offset = allocationEnd;
+				range.size = rangeEnd - allocationEnd;
+			}
+			else {
+				block.freeList.erase(block.freeList.begin() + i);
+			}
+
+			return true;
+		}
+
+		return false;
+	}
+
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memoryProperties{};
+	bool memoryBudgetEnabled = false;
+	/* bytes this allocator has taken from each heap (fallback budget) */
+	VkDeviceSize heapUsed[VK_MAX_MEMORY_HEAPS] = {};
+	std::vector<Block> blocks;
+	std::vector<FrameArena> frameArenas;
+};
@@ -0,0 +1,248 @@
+#pragma once
+
+//Include Vulkan
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Hash-cache for descriptor set layouts.
+ *
+ * Pipelines that bind the same resources end up asking for bit-identical
+ * layouts; creating one VkDescriptorSetLayout per request wastes driver
+ * objects and - worse - makes otherwise compatible pipeline layouts
+ * incompatible for descriptor set reuse. The cache keys on the binding
+ * list (plus create flags) and returns the same handle for the same
+ * request, so identical layouts are deduplicated across all pipelines.
+ *
+ * Layouts live until destroy(); the owners never destroy them
+ * individually.
+ */
+class DescriptorLayoutCache {
+public:
+
+	void init(VkDevice device) {
+		this->device = device;
+	}
+
+	/**
+	 * Returns the layout for the given bindings, creating it on first use
+	 * and reusing it afterwards. The binding list must be sorted by
+	 * binding index (all callers build them that way anyway)
+	 * @param bindings	the layout's bindings, sorted by binding index
+	 * @param flags		layout create flags (e.g. push descriptor bit)
+	 */
+	VkDescriptorSetLayout getLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+			VkDescriptorSetLayoutCreateFlags flags = 0) {
+		LayoutKey key;
+		key.flags = flags;
+		key.bindings = bindings;
+
+		auto it = layouts.find(key);
+		if (it != layouts.end()) {
+			return it->second;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.flags = flags;
+		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		layoutInfo.pBindings = bindings.data();
+
+		VkDescriptorSetLayout layout;
+		if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor set layout!");
+		}
+
+		layouts[key] = layout;
+		return layout;
+	}
+
+	void destroy() {
+		for (auto& entry : layouts) {
+			vkDestroyDescriptorSetLayout(device, entry.second, nullptr);
+		}
+		layouts.clear();
+	}
+
+private:
+
+	/* one cache key: the create flags plus the full binding list */
+	struct LayoutKey {
+		VkDescriptorSetLayoutCreateFlags flags = 0;
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+		bool operator==(const LayoutKey& other) const {
+			if (flags != other.flags || bindings.size() != other.bindings.size()) {
+				return false;
+			}
+			// the structs are plain data - compare them bytewise
+			return bindings.empty() ||
+				memcmp(bindings.data(), other.bindings.data(),
+					bindings.size() * sizeof(VkDescriptorSetLayoutBinding)) == 0;
+		}
+	};
+
+	struct LayoutKeyHash {
+		size_t operator()(const LayoutKey& key) const {
+			// FNV-1a over the fields that matter
+			size_t hash = 14695981039346656037ull;
+			auto mix = [&hash](uint64_t value) {
+				hash = (hash ^ value) * 1099511628211ull;
+			};
+			mix(key.flags);
+			for (const VkDescriptorSetLayoutBinding& binding : key.bindings) {
+				mix(binding.binding);
+				mix(binding.descriptorType);
+				mix(binding.descriptorCount);
+				mix(binding.stageFlags);
+			}
+			return hash;
+		}
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> layouts;
+};
+
+/**
+ * Pooled descriptor set allocator.
+ *
+ * Descriptor pools are arenas: sets are allocated pool-linearly and
+ * never freed individually (no FREE_DESCRIPTOR_SET_BIT - individual
+ * frees fragment the pool and cost a driver call each). Two kinds of
+ * arenas exist:
+ *  - the persistent arena for sets that live as long as the renderer
+ *    (the uniform ring set, the per-frame cull sets)
+ *  - one transient arena per frame in flight, reset wholesale in
+ *    beginFrame() via vkResetDescriptorPool - one call returns every
+ *    set of the frame, which is far cheaper than freeing them one by
+ *    one. Material systems that bake sets per frame allocate here
+ *
+ * When a pool runs out a new one is chained, so the arenas grow to
+ * whatever the scene needs. Pool sizes carry a generic mix of the
+ * descriptor types the renderer uses; exotic types just get a new
+ * chained pool via the VK_ERROR_OUT_OF_POOL_MEMORY path.
+ */
+class DescriptorAllocator {
+public:
+
+	/* sets per backing pool (a new pool is chained when exhausted) */
+	static const uint32_t SETS_PER_POOL = 256;
+
+	void init(VkDevice device, uint32_t framesInFlight) {
+		this->device = device;
+		frameArenas.resize(framesInFlight);
+	}
+
+	/**
+	 * Resets the given frame's transient arena. Call once per frame,
+	 * after the frame's fence has been waited on - every transient set
+	 * handed out for this frame index becomes invalid here
+	 * @param frame		frame in flight index
+	 */
+	void beginFrame(uint32_t frame) {
+		Arena& arena = frameArenas[frame];
+		for (VkDescriptorPool pool : arena.pools) {
+			vkResetDescriptorPool(device, pool, 0);
+		}
+		arena.current = 0;
+	}
+
+	/* allocates a set that lives until destroy() */
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout) {
+		return allocateFrom(persistent, layout);
+	}
+
+	/**
+	 * Allocates a set valid until beginFrame(frame) runs again
+	 * @param frame		frame in flight index
+	 * @param layout	the set's layout
+	 */
+	VkDescriptorSet allocateTransient(uint32_t frame, VkDescriptorSetLayout layout) {
+		return allocateFrom(frameArenas[frame], layout);
+	}
+
+	void destroy() {
+		for (VkDescriptorPool pool : persistent.pools) {
+			vkDestroyDescriptorPool(device, pool, nullptr);
+		}
+		persistent.pools.clear();
+		for (Arena& arena : frameArenas) {
+			for (VkDescriptorPool pool : arena.pools) {
+				vkDestroyDescriptorPool(device, pool, nullptr);
+			}
+		}
+		frameArenas.clear();
+	}
+
+private:
+
+	/* a growable chain of pools; `current` is the one being filled */
+	struct Arena {
+		std::vector<VkDescriptorPool> pools;
+		size_t current = 0;
+	};
+
+	VkDescriptorPool createPool() {
+		// a generic mix - any one pool can serve whatever combination the
+		// scene's layouts ask for
+		VkDescriptorPoolSize poolSizes[] = {
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,			SETS_PER_POOL },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,	SETS_PER_POOL },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,			SETS_PER_POOL * 4 },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,	SETS_PER_POOL * 2 },
+		};
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		// no FREE_DESCRIPTOR_SET_BIT: sets are only ever returned through
+		// whole-pool resets
+		poolInfo.poolSizeCount = static_cast<uint32_t>(sizeof(poolSizes) / sizeof(poolSizes[0]));
+		poolInfo.pPoolSizes = poolSizes;
+		poolInfo.maxSets = SETS_PER_POOL;
+
+		VkDescriptorPool pool;
+		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor pool!");
+		}
+		return pool;
+	}
+
+	VkDescriptorSet allocateFrom(Arena& arena, VkDescriptorSetLayout layout) {
+		if (arena.pools.empty()) {
+			arena.pools.push_back(createPool());
+			arena.current = 0;
+		}
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &layout;
+
+		VkDescriptorSet set;
+		allocInfo.descriptorPool = arena.pools[arena.current];
+		VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+
+		if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+			// the current pool is full - chain a fresh one and retry there
+			arena.pools.push_back(createPool());
+			arena.current = arena.pools.size() - 1;
+			allocInfo.descriptorPool = arena.pools[arena.current];
+			result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+		}
+
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate descriptor set!");
+		}
+		return set;
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	Arena persistent;
+	std::vector<Arena> frameArenas;
+};
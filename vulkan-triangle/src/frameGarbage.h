@@ -0,0 +1,241 @@
+#pragma once
+
+//Include Vulkan
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <cstdint>
+
+#include "bufferAllocator.h"
+
+/**
+ * Central deferred-destruction queue ("frame garbage").
+ *
+ * Destroying a resource the moment it is replaced would require proving
+ * that no frame in flight still references it - the old code proved it
+ * with vkDeviceWaitIdle, a multi-millisecond full-GPU stall. Instead,
+ * every dynamic feature (swap chain recreation, shader hot reload,
+ * window resizes, streaming) enqueues its dead handles here; collect()
+ * runs once per frame right after the frame boundary wait and destroys
+ * an entry once framesInFlight further frame waits have passed - at
+ * that point no submitted work can reference it. No stall anywhere.
+ *
+ * Entries are typed PODs pooled in a free list, so enqueueing does not
+ * allocate once the pool has warmed up (the vector grows to the high
+ * water mark of simultaneously retired objects and stays there).
+ */
+class FrameGarbage {
+public:
+
+	/**
+	 * @param device			the logical device the handles belong to
+	 * @param allocator			frees the memory behind buffer/image entries
+	 * @param framesInFlight	frame waits before destruction is safe
+	 */
+	void init(VkDevice device, BufferAllocator* allocator, int framesInFlight) {
+		this->device = device;
+		this->allocator = allocator;
+		this->framesInFlight = framesInFlight;
+	}
+
+	/* --- typed enqueue entry points ------------------------------------ */
+
+	void destroyBuffer(VkBuffer buffer, const BufferAllocator::Allocation& allocation) {
+		Entry& entry = obtain();
+		entry.type = Type::BUFFER;
+		entry.buffer = buffer;
+		entry.allocation = allocation;
+	}
+
+	void destroyImage(VkImage image, const BufferAllocator::Allocation& allocation) {
+		Entry& entry = obtain();
+		entry.type = Type::IMAGE;
+		entry.image = image;
+		entry.allocation = allocation;
+	}
+
+	void destroyImageView(VkImageView imageView) {
+		Entry& entry = obtain();
+		entry.type = Type::IMAGE_VIEW;
+		entry.imageView = imageView;
+	}
+
+	void destroyFramebuffer(VkFramebuffer framebuffer) {
+		Entry& entry = obtain();
+		entry.type = Type::FRAMEBUFFER;
+		entry.framebuffer = framebuffer;
+	}
+
+	void destroySwapchain(VkSwapchainKHR swapChain) {
+		Entry& entry = obtain();
+		entry.type = Type::SWAPCHAIN;
+		entry.swapChain = swapChain;
+	}
+
+	void destroyPipeline(VkPipeline pipeline) {
+		Entry& entry = obtain();
+		entry.type = Type::PIPELINE;
+		entry.pipeline = pipeline;
+	}
+
+	void destroyPipelineLayout(VkPipelineLayout pipelineLayout) {
+		Entry& entry = obtain();
+		entry.type = Type::PIPELINE_LAYOUT;
+		entry.pipelineLayout = pipelineLayout;
+	}
+
+	void destroyRenderPass(VkRenderPass renderPass) {
+		Entry& entry = obtain();
+		entry.type = Type::RENDER_PASS;
+		entry.renderPass = renderPass;
+	}
+
+	void destroyQueryPool(VkQueryPool queryPool) {
+		Entry& entry = obtain();
+		entry.type = Type::QUERY_POOL;
+		entry.queryPool = queryPool;
+	}
+
+	void destroySemaphore(VkSemaphore semaphore) {
+		Entry& entry = obtain();
+		entry.type = Type::SEMAPHORE;
+		entry.semaphore = semaphore;
+	}
+
+	/* ------------------------------------------------------------------- */
+
+	/**
+	 * Ages every entry by one frame wait and destroys those whose
+	 * deferral period has elapsed. Call once per frame, right after the
+	 * frame boundary wait in drawFrame()
+	 */
+	void collect() {
+		for (Entry& entry : entries) {
+			if (entry.type == Type::FREE) {
+				continue;
+			}
+			entry.framesRemaining--;
+			if (entry.framesRemaining > 0) {
+				continue;
+			}
+			destroy(entry);
+			entry.type = Type::FREE;
+			freeList.push_back(&entry - entries.data());
+		}
+	}
+
+	/**
+	 * Destroys everything immediately. Only valid once the device is
+	 * idle (shutdown)
+	 */
+	void flush() {
+		for (Entry& entry : entries) {
+			if (entry.type == Type::FREE) {
+				continue;
+			}
+			destroy(entry);
+			entry.type = Type::FREE;
+		}
+		entries.clear();
+		freeList.clear();
+	}
+
+private:
+
+	enum class Type {
+		FREE,	// pooled entry, currently unused
+		BUFFER,
+		IMAGE,
+		IMAGE_VIEW,
+		FRAMEBUFFER,
+		SWAPCHAIN,
+		PIPELINE,
+		PIPELINE_LAYOUT,
+		RENDER_PASS,
+		QUERY_POOL,
+		SEMAPHORE,
+	};
+
+	/* one retired object: the handle, its memory (images/buffers only)
+	 * and the frame waits left before destruction is safe */
+	struct Entry {
+		Type type = Type::FREE;
+		union {
+			VkBuffer buffer;
+			VkImage image;
+			VkImageView imageView;
+			VkFramebuffer framebuffer;
+			VkSwapchainKHR swapChain;
+			VkPipeline pipeline;
+			VkPipelineLayout pipelineLayout;
+			VkRenderPass renderPass;
+			VkQueryPool queryPool;
+			VkSemaphore semaphore;
+		};
+		BufferAllocator::Allocation allocation;
+		int framesRemaining = 0;
+	};
+
+	/* hands out a pooled entry (free list first, grow as last resort)
+	 * with the deferral counter already armed */
+	Entry& obtain() {
+		if (!freeList.empty()) {
+			Entry& entry = entries[freeList.back()];
+			freeList.pop_back();
+			entry.allocation = BufferAllocator::Allocation{};
+			entry.framesRemaining = framesInFlight;
+			return entry;
+		}
+		entries.emplace_back();
+		Entry& entry = entries.back();
+		entry.framesRemaining = framesInFlight;
+		return entry;
+	}
+
+	void destroy(Entry& entry) {
+		switch (entry.type) {
+		case Type::BUFFER:
+			vkDestroyBuffer(device, entry.buffer, nullptr);
+			allocator->free(entry.allocation);
+			break;
+		case Type::IMAGE:
+			vkDestroyImage(device, entry.image, nullptr);
+			allocator->free(entry.allocation);
+			break;
+		case Type::IMAGE_VIEW:
+			vkDestroyImageView(device, entry.imageView, nullptr);
+			break;
+		case Type::FRAMEBUFFER:
+			vkDestroyFramebuffer(device, entry.framebuffer, nullptr);
+			break;
+		case Type::SWAPCHAIN:
+			vkDestroySwapchainKHR(device, entry.swapChain, nullptr);
+			break;
+		case Type::PIPELINE:
+			vkDestroyPipeline(device, entry.pipeline, nullptr);
+			break;
+		case Type::PIPELINE_LAYOUT:
+			vkDestroyPipelineLayout(device, entry.pipelineLayout, nullptr);
+			break;
+		case Type::RENDER_PASS:
+			vkDestroyRenderPass(device, entry.renderPass, nullptr);
+			break;
+		case Type::QUERY_POOL:
+			vkDestroyQueryPool(device, entry.queryPool, nullptr);
+			break;
+		case Type::SEMAPHORE:
+			vkDestroySemaphore(device, entry.semaphore, nullptr);
+			break;
+		case Type::FREE:
+			break;
+		}
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	BufferAllocator* allocator = nullptr;
+	int framesInFlight = 0;
+
+	/* the entry pool plus the indices of the unused slots */
+	std::vector<Entry> entries;
+	std::vector<size_t> freeList;
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <cstdint>
+
+/**
+ * Rolling per-phase frame statistics.
+ *
+ * drawFrame() reports how long each phase of a frame took (fence wait,
+ * image acquire, queue submit, present and the GPU execution time measured
+ * with timestamp queries). The samples are kept in fixed size ring buffers
+ * (single producer, no locks - everything happens on the render thread)
+ * and p50/p95/p99 percentiles are dumped periodically to stdout in CSV
+ * form, so frame spikes can be attributed to a phase without a profiler
+ * attached.
+ */
+class FrameStats {
+public:
+	/* the phases of a frame that are timed individually */
+	enum Phase {
+		PHASE_WAIT_FENCES = 0,	// frame boundary wait (timeline host wait)
+		PHASE_ACQUIRE,			// vkAcquireNextImageKHR
+		PHASE_SUBMIT,			// vkQueueSubmit
+		PHASE_PRESENT,			// vkQueuePresentKHR
+		PHASE_GPU,				// GPU time between the two vkCmdWriteTimestamp queries
+		PHASE_FRAME,			// whole drawFrame() call
+		PHASE_COUNT
+	};
+
+	/* number of samples kept per phase (ring buffer size) */
+	static const size_t WINDOW_SIZE = 256;
+	/* a CSV line is printed every DUMP_INTERVAL frames */
+	static const size_t DUMP_INTERVAL = 240;
+
+	/* when false, samples keep accumulating but endFrame() never prints -
+	 * for consumers that read the rings themselves (benchmark harness) */
+	bool csvDump = true;
+
+	/* record one sample (in milliseconds) for a phase */
+	void addSample(Phase phase, double milliseconds) {
+		Ring& ring = rings[phase];
+		ring.samples[ring.head] = milliseconds;
+		ring.head = (ring.head + 1) % WINDOW_SIZE;
+		if (ring.count < WINDOW_SIZE) {
+			ring.count++;
+		}
+	}
+
+	/**
+	 * Called once per frame; prints the CSV header on the first call and
+	 * a line with p50/p95/p99 per phase every DUMP_INTERVAL frames
+	 */
+	void endFrame() {
+		frameIndex++;
+		if (!csvDump || frameIndex % DUMP_INTERVAL != 0) {
+			return;
+		}
+
+		if (!headerPrinted) {
+			std::cout << "frame";
+			for (size_t p = 0; p < PHASE_COUNT; p++) {
+				std::cout << "," << phaseName((Phase)p) << "_p50"
+					<< "," << phaseName((Phase)p) << "_p95"
+					<< "," << phaseName((Phase)p) << "_p99";
+			}
+			std::cout << std::endl;
+			headerPrinted = true;
+		}
+
+		std::cout << frameIndex;
+		for (size_t p = 0; p < PHASE_COUNT; p++) {
+			std::cout << "," << percentile((Phase)p, 0.50)
+				<< "," << percentile((Phase)p, 0.95)
+				<< "," << percentile((Phase)p, 0.99);
+		}
+		std::cout << std::endl;
+	}
+
+	/**
+	 * Computes a percentile (0..1) over the current window of a phase.
+	 * Sorts a copy of the window - only called on dump frames, so the
+	 * cost does not show up in the steady state
+	 */
+	double percentile(Phase phase, double p) const {
+		const Ring& ring = rings[phase];
+		if (ring.count == 0) {
+			return 0.0;
+		}
+
+		std::array<double, WINDOW_SIZE> sorted;
+		std::copy(ring.samples.begin(), ring.samples.begin() + ring.count, sorted.begin());
+		std::sort(sorted.begin(), sorted.begin() + ring.count);
+
+		size_t index = (size_t)(p * (ring.count - 1));
+		return sorted[index];
+	}
+
+	/* small RAII helper that times a scope and reports it as one sample */
+	class ScopedTimer {
+	public:
+		ScopedTimer(FrameStats& stats, Phase phase)
+			: stats(stats), phase(phase), start(std::chrono::steady_clock::now()) {
+		}
+		~ScopedTimer() {
+			auto end = std::chrono::steady_clock::now();
+			stats.addSample(phase, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+	private:
+		FrameStats& stats;
+		Phase phase;
+		std::chrono::steady_clock::time_point start;
+	};
+
+private:
+	/* fixed size ring buffer for one phase */
+	struct Ring {
+		std::array<double, WINDOW_SIZE> samples = {};
+		size_t head = 0;
+		size_t count = 0;
+	};
+
+	static const char* phaseName(Phase phase) {
+		switch (phase) {
+		case PHASE_WAIT_FENCES:	return "wait";
+		case PHASE_ACQUIRE:		return "acquire";
+		case PHASE_SUBMIT:		return "submit";
+		case PHASE_PRESENT:		return "present";
+		case PHASE_GPU:			return "gpu";
+		case PHASE_FRAME:		return "frame";
+		default:				return "unknown";
+		}
+	}
+
+	std::array<Ring, PHASE_COUNT> rings;
+	uint64_t frameIndex = 0;
+	bool headerPrinted = false;
+};
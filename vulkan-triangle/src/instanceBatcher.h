@@ -0,0 +1,154 @@
+#pragma once
+
+//Include Vulkan
+#include <vulkan/vulkan.h>
+
+//Include GLM
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * Collapses per-object draws into instanced draw calls.
+ *
+ * Objects are submitted one by one each frame; buildBatches() sorts them
+ * by pipeline first (so state changes are minimized) and by mesh second,
+ * then emits one batch per (pipeline, mesh) run - each batch becomes a
+ * single vkCmdDrawIndexed with instanceCount > 1 instead of one draw per
+ * object. The per-instance attributes come out as structure-of-arrays
+ * (transforms and colors in separate buffers/bindings), so the vertex
+ * fetch of an attribute the shader does not read costs nothing.
+ *
+ * Everything is rebuilt per frame from scratch - with a few thousand
+ * objects the sort is cheap next to the draw calls it saves.
+ */
+class InstanceBatcher {
+public:
+
+	/* one run of identical (pipeline, mesh) submissions */
+	struct Batch {
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		uint32_t meshId = 0;
+		/* index of the batch's first instance in the SoA arrays */
+		uint32_t firstInstance = 0;
+		uint32_t instanceCount = 0;
+	};
+
+	/* drops all submissions of the previous frame */
+	void clear() {
+		submissions.clear();
+		batches.clear();
+		transformArray.clear();
+		colorArray.clear();
+	}
+
+	/**
+	 * Submits one object for this frame
+	 * @param pipeline	pipeline the object is drawn with (primary sort key)
+	 * @param meshId	identifies the mesh / vertex+index buffer pair
+	 * @param transform	packed 2D transform: offset.xy, scale, rotation
+	 * @param color		per-instance color
+	 */
+	void add(VkPipeline pipeline, uint32_t meshId, const glm::vec4& transform, const glm::vec3& color) {
+		submissions.push_back({ pipeline, meshId, transform, color });
+	}
+
+	/**
+	 * Sorts the submissions into pipeline/mesh buckets and fills the SoA
+	 * instance arrays in batch order. Call once per frame, then upload
+	 * transforms()/colors() and issue one draw per batch
+	 */
+	const std::vector<Batch>& buildBatches() {
+		batches.clear();
+		transformArray.clear();
+		colorArray.clear();
+
+		// stable sort keeps submission order within a bucket deterministic
+		std::stable_sort(submissions.begin(), submissions.end(),
+			[](const Submission& a, const Submission& b) {
+				if (a.pipeline != b.pipeline) return a.pipeline < b.pipeline;
+				return a.meshId < b.meshId;
+			});
+
+		for (const Submission& submission : submissions) {
+			if (batches.empty() ||
+				batches.back().pipeline != submission.pipeline ||
+				batches.back().meshId != submission.meshId) {
+				Batch batch;
+				batch.pipeline = submission.pipeline;
+				batch.meshId = submission.meshId;
+				batch.firstInstance = static_cast<uint32_t>(transformArray.size());
+				batch.instanceCount = 0;
+				batches.push_back(batch);
+			}
+			batches.back().instanceCount++;
+
+			transformArray.push_back(submission.transform);
+			colorArray.push_back(submission.color);
+		}
+
+		return batches;
+	}
+
+	/* the batch list built by the last buildBatches() call */
+	const std::vector<Batch>& getBatches() const { return batches; }
+
+	/* SoA per-instance data in batch order (valid after buildBatches) */
+	const std::vector<glm::vec4>& transforms() const { return transformArray; }
+	const std::vector<glm::vec3>& colors() const { return colorArray; }
+
+	uint32_t instanceCount() const { return static_cast<uint32_t>(transformArray.size()); }
+
+	/* the two per-instance vertex bindings (transforms and colors as SoA) */
+	static std::array<VkVertexInputBindingDescription, 2> getBindingDescriptions() {
+		std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {};
+
+		// transforms: one vec4 per instance
+		bindingDescriptions[0].binding = 1;
+		bindingDescriptions[0].stride = sizeof(glm::vec4);
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+		// colors: one vec3 per instance
+		bindingDescriptions[1].binding = 2;
+		bindingDescriptions[1].stride = sizeof(glm::vec3);
+		bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+		return bindingDescriptions;
+	}
+
+	/* the matching attributes (locations continue after the Vertex ones) */
+	static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions = {};
+
+		// transform: vec4 -> VK_FORMAT_R32G32B32A32_SFLOAT
+		attributeDescriptions[0].binding = 1;
+		attributeDescriptions[0].location = 2;
+		attributeDescriptions[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attributeDescriptions[0].offset = 0;
+
+		// color: vec3 -> VK_FORMAT_R32G32B32_SFLOAT
+		attributeDescriptions[1].binding = 2;
+		attributeDescriptions[1].location = 3;
+		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attributeDescriptions[1].offset = 0;
+
+		return attributeDescriptions;
+	}
+
+private:
+	/* one submitted object before sorting */
+	struct Submission {
+		VkPipeline pipeline;
+		uint32_t meshId;
+		glm::vec4 transform;
+		glm::vec3 color;
+	};
+
+	std::vector<Submission> submissions;
+	std::vector<Batch> batches;
+	std::vector<glm::vec4> transformArray;
+	std::vector<glm::vec3> colorArray;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+//Include Vulkan
+#include <vulkan/vulkan.h>
+
+#include <stdexcept>
+#include <cstdint>
+
+/**
+ * One monotonic timeline semaphore per queue (VK_KHR_timeline_semaphore).
+ *
+ * Binary semaphores and fences are one-shot objects: every dependency
+ * needs its own handle, arrays of them per frame in flight, and manual
+ * resets. A timeline is a single 64 bit counter per queue that only
+ * ever counts up - a submit signals "value N" and anyone, host or
+ * another queue, waits on "value >= N". Frame pacing, swap chain image
+ * reuse and cross-queue upload chains all become compares against one
+ * counter; nothing is ever reset or recreated, and a host wait targets
+ * the exact submit it cares about instead of a fence array slot.
+ *
+ * The presentation engine is the one holdout: vkAcquireNextImageKHR and
+ * vkQueuePresentKHR only take binary semaphores, so those keep their
+ * per-frame pairs - everything else runs on timelines.
+ *
+ * Values are handed out by nextValue() on the thread that submits, so
+ * signals enter the queue in increasing order as the spec requires.
+ */
+class QueueTimeline {
+public:
+
+	/**
+	 * Creates the timeline (initial value 0) and resolves the extension
+	 * entry points. The device must have been created with the
+	 * VK_KHR_timeline_semaphore feature enabled
+	 */
+	void init(VkDevice device) {
+		this->device = device;
+
+		// extension entry points are not part of the statically linked
+		// loader API (the app targets Vulkan 1.1, where timelines are
+		// not yet core)
+		pfnWaitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(
+			vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR"));
+		pfnGetSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(
+			vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR"));
+		if (pfnWaitSemaphores == nullptr || pfnGetSemaphoreCounterValue == nullptr) {
+			throw std::runtime_error("failed to load timeline semaphore entry points!");
+		}
+
+		VkSemaphoreTypeCreateInfoKHR typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create timeline semaphore!");
+		}
+	}
+
+	void destroy() {
+		if (semaphore != VK_NULL_HANDLE) {
+			vkDestroySemaphore(device, semaphore, nullptr);
+			semaphore = VK_NULL_HANDLE;
+		}
+	}
+
+	/* the semaphore handle, for submit info wait/signal lists */
+	VkSemaphore handle() const { return semaphore; }
+
+	/**
+	 * Reserves the value the next submit on this queue will signal.
+	 * Value 0 is never handed out - it means "nothing ever submitted",
+	 * and waits on it fall through
+	 */
+	uint64_t nextValue() {
+		return ++lastValue;
+	}
+
+	/* the most recently reserved value (what the queue will reach) */
+	uint64_t submittedValue() const { return lastValue; }
+
+	/**
+	 * Blocks the host until the timeline reaches the given value. A
+	 * value of 0 ("never submitted") returns immediately
+	 * @param value		timeline value to wait for
+	 */
+	void hostWait(uint64_t value) const {
+		if (value == 0) {
+			return;
+		}
+
+		VkSemaphoreWaitInfoKHR waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &semaphore;
+		waitInfo.pValues = &value;
+
+		if (pfnWaitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+			throw std::runtime_error("failed to wait on timeline semaphore!");
+		}
+	}
+
+	/* the value the queue has completed so far (one driver call - cache
+	 * the result when polling many values in a row) */
+	uint64_t completedValue() const {
+		uint64_t value = 0;
+		if (pfnGetSemaphoreCounterValue(device, semaphore, &value) != VK_SUCCESS) {
+			throw std::runtime_error("failed to query timeline semaphore value!");
+		}
+		return value;
+	}
+
+private:
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+
+	/* the last value handed out to a submit; only grows */
+	uint64_t lastValue = 0;
+
+	PFN_vkWaitSemaphoresKHR pfnWaitSemaphores = nullptr;
+	PFN_vkGetSemaphoreCounterValueKHR pfnGetSemaphoreCounterValue = nullptr;
+};
@@ -0,0 +1,293 @@
+#pragma once
+
+//Include Vulkan
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <stdexcept>
+
+/**
+ * Worker pool for recording secondary command buffers in parallel.
+ *
+ * Command pools are externally synchronized objects, so every worker owns
+ * one pool per frame in flight and only ever records through its own pools.
+ * The draw work of a frame is split into batches (one secondary command
+ * buffer each); the workers pull batch indices from a shared atomic cursor,
+ * so a slow batch on one thread never leaves the others idle. The caller
+ * assembles the resulting buffers into the primary command buffer with
+ * vkCmdExecuteCommands inside the render pass.
+ *
+ * The threads are persistent - they are started once in init() and park on
+ * a condition variable between frames, so recording a frame never pays for
+ * thread creation.
+ */
+class RecordingWorkerPool {
+public:
+	/* a batch records its draw commands into the given secondary buffer;
+	 * begin/end of the buffer is handled by the pool */
+	using RecordBatch = std::function<void(VkCommandBuffer)>;
+
+	/**
+	 * Starts the workers and creates the per-worker per-frame command pools
+	 * @param device			logical device
+	 * @param queueFamilyIndex	graphics family the secondary buffers are recorded for
+	 * @param framesInFlight	number of frames in flight (pool ring size)
+	 */
+	void init(VkDevice device, uint32_t queueFamilyIndex, size_t framesInFlight) {
+		this->device = device;
+		this->framesInFlight = framesInFlight;
+		this->mainQueueFamilyIndex = queueFamilyIndex;
+
+		// leave one core for the main thread, but always have at least one worker
+		size_t threadCount = std::thread::hardware_concurrency();
+		workerCount = threadCount > 1 ? threadCount - 1 : 1;
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = queueFamilyIndex;
+		// the buffers are re-recorded every frame (pool reset in bulk)
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		workers.resize(workerCount);
+		for (size_t w = 0; w < workerCount; w++) {
+			workers[w].pools.resize(framesInFlight);
+			for (size_t f = 0; f < framesInFlight; f++) {
+				if (vkCreateCommandPool(device, &poolInfo, nullptr, &workers[w].pools[f]) != VK_SUCCESS) {
+					throw std::runtime_error("failed to create worker command pool!");
+				}
+			}
+		}
+
+		for (size_t w = 0; w < workerCount; w++) {
+			workers[w].thread = std::thread(&RecordingWorkerPool::workerMain, this, w);
+		}
+	}
+
+	/**
+	 * Resets the given frame's pools of all workers - must only be called
+	 * when that frame's previous submission has completed (fence waited)
+	 */
+	void resetFrame(size_t frame) {
+		for (size_t w = 0; w < workerCount; w++) {
+			vkResetCommandPool(device, workers[w].pools[frame], 0);
+		}
+		if (!mainThreadPools.empty()) {
+			vkResetCommandPool(device, mainThreadPools[frame], 0);
+		}
+	}
+
+	/**
+	 * Records one secondary command buffer per batch, distributed across
+	 * the workers (the calling thread participates as well). Blocks until
+	 * all batches are recorded.
+	 * @param frame			current frame in flight (selects the pools)
+	 * @param inheritance	render pass / framebuffer the secondaries execute in
+	 * @param batches		draw command recording callbacks, one per batch
+	 * @return the recorded secondary buffers, in batch order
+	 */
+	std::vector<VkCommandBuffer> recordBatches(size_t frame,
+		const VkCommandBufferInheritanceInfo& inheritance,
+		const std::vector<RecordBatch>& batches) {
+
+		std::vector<VkCommandBuffer> result(batches.size());
+
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobFrame = frame;
+			jobInheritance = &inheritance;
+			jobBatches = &batches;
+			jobResult = &result;
+			nextBatch.store(0);
+			pendingBatches.store(batches.size());
+			generation++;
+		}
+		jobReady.notify_all();
+
+		// the calling thread pulls batches too instead of just waiting
+		drainBatches(workerCount);	// worker index workerCount = main thread pools
+
+		// wait until the workers have finished their in-flight batches AND
+		// stepped out of drainBatches - pendingBatches == 0 only says the
+		// batches are recorded, a worker may still be about to read the
+		// job publication that dies with this stack frame
+		std::unique_lock<std::mutex> lock(jobMutex);
+		jobDone.wait(lock, [this] {
+			return pendingBatches.load() == 0 && activeWorkers.load() == 0;
+		});
+
+		return result;
+	}
+
+	/* stops the threads and destroys the pools (device must be idle) */
+	void destroy() {
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			shutdown = true;
+			generation++;
+		}
+		jobReady.notify_all();
+
+		for (size_t w = 0; w < workerCount; w++) {
+			if (workers[w].thread.joinable()) {
+				workers[w].thread.join();
+			}
+			for (VkCommandPool pool : workers[w].pools) {
+				vkDestroyCommandPool(device, pool, nullptr);
+			}
+		}
+		workers.clear();
+
+		if (mainThreadPools.size() > 0) {
+			for (VkCommandPool pool : mainThreadPools) {
+				vkDestroyCommandPool(device, pool, nullptr);
+			}
+			mainThreadPools.clear();
+		}
+	}
+
+	size_t getWorkerCount() const { return workerCount; }
+
+private:
+	/* per worker thread state: its thread and one pool per frame in flight */
+	struct Worker {
+		std::thread thread;
+		std::vector<VkCommandPool> pools;
+	};
+
+	/* loop of a worker thread: park until a job is published, then pull batches */
+	void workerMain(size_t workerIndex) {
+		uint64_t seenGeneration = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(jobMutex);
+				jobReady.wait(lock, [&] { return generation != seenGeneration; });
+				seenGeneration = generation;
+				if (shutdown) {
+					return;
+				}
+				// register while still under the lock: recordBatches must
+				// not return (its batch/result vectors die with its stack
+				// frame) while this thread may still dereference them
+				activeWorkers.fetch_add(1);
+			}
+			drainBatches(workerIndex);
+			{
+				std::unique_lock<std::mutex> lock(jobMutex);
+				activeWorkers.fetch_sub(1);
+				jobDone.notify_one();
+			}
+		}
+	}
+
+	/* pulls batch indices from the shared cursor until none are left */
+	void drainBatches(size_t workerIndex) {
+		// a worker can wake late, after the job it was notified for has
+		// completed and its publication is gone - with no batches pending
+		// there is nothing the pointers may be touched for
+		if (pendingBatches.load() == 0) {
+			return;
+		}
+		while (true) {
+			size_t batchIndex = nextBatch.fetch_add(1);
+			if (batchIndex >= jobBatches->size()) {
+				return;
+			}
+
+			recordOne(workerIndex, batchIndex);
+
+			if (pendingBatches.fetch_sub(1) == 1) {
+				// last batch finished - wake the caller
+				std::unique_lock<std::mutex> lock(jobMutex);
+				jobDone.notify_one();
+			}
+		}
+	}
+
+	/* records a single batch into a fresh secondary buffer of this worker */
+	void recordOne(size_t workerIndex, size_t batchIndex) {
+		VkCommandPool pool = poolFor(workerIndex, jobFrame);
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = pool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate secondary command buffer!");
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		// the buffer lives entirely inside the render pass of the primary
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+			VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		beginInfo.pInheritanceInfo = jobInheritance;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin secondary command buffer!");
+		}
+
+		(*jobBatches)[batchIndex](commandBuffer);
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record secondary command buffer!");
+		}
+
+		(*jobResult)[batchIndex] = commandBuffer;
+	}
+
+	/* pools of a worker; index == workerCount selects the main thread's pools */
+	VkCommandPool poolFor(size_t workerIndex, size_t frame) {
+		if (workerIndex < workerCount) {
+			return workers[workerIndex].pools[frame];
+		}
+
+		// lazily create pools for the calling (main) thread
+		if (mainThreadPools.empty()) {
+			VkCommandPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.queueFamilyIndex = mainQueueFamilyIndex;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+			mainThreadPools.resize(framesInFlight);
+			for (size_t f = 0; f < framesInFlight; f++) {
+				if (vkCreateCommandPool(device, &poolInfo, nullptr, &mainThreadPools[f]) != VK_SUCCESS) {
+					throw std::runtime_error("failed to create main thread command pool!");
+				}
+			}
+		}
+		return mainThreadPools[frame];
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	size_t framesInFlight = 0;
+	size_t workerCount = 0;
+	uint32_t mainQueueFamilyIndex = 0;
+
+	std::vector<Worker> workers;
+	/* pools used when the calling thread records batches itself */
+	std::vector<VkCommandPool> mainThreadPools;
+
+	// job publication (protected by jobMutex, consumed lock-free via the cursor)
+	std::mutex jobMutex;
+	std::condition_variable jobReady;
+	std::condition_variable jobDone;
+	uint64_t generation = 0;
+	bool shutdown = false;
+
+	size_t jobFrame = 0;
+	const VkCommandBufferInheritanceInfo* jobInheritance = nullptr;
+	const std::vector<RecordBatch>* jobBatches = nullptr;
+	std::vector<VkCommandBuffer>* jobResult = nullptr;
+	std::atomic<size_t> nextBatch{ 0 };
+	std::atomic<size_t> pendingBatches{ 0 };
+	/* workers currently inside drainBatches (holding the job pointers) */
+	std::atomic<size_t> activeWorkers{ 0 };
+};
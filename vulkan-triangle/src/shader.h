@@ -3,10 +3,92 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 #include <fstream>
+#include <string>
+#include <stdexcept>
+#include <unordered_map>
+#include <filesystem>
+
+// memory mapping is used for zero-copy SPIR-V loading where available
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define SHADER_HAS_MMAP 1
+#endif
 
 class Shader {
 public:
 
+	/// <summary>
+	/// Returns the shader module for a SPIR-V file, creating it on first
+	/// use and reusing it afterwards. The cache is keyed by path and file
+	/// modification time, so a recompiled shader is picked up while an
+	/// unchanged file never touches the filesystem again - swap chain
+	/// recreation (which rebuilds the pipeline) becomes IO-free.
+	/// </summary>
+	/// <param name="device">The device.</param>
+	/// <param name="path">Path to the .spv file.</param>
+	/// <returns>The cached shader module.</returns>
+	static VkShaderModule getModule(VkDevice device, const std::string& path) {
+		auto& modules = cache();
+
+		std::filesystem::file_time_type mtime = std::filesystem::last_write_time(path);
+
+		auto it = modules.find(path);
+		if (it != modules.end()) {
+			if (it->second.mtime == mtime) {
+				return it->second.module;
+			}
+			// the file changed on disk - drop the stale module
+			// (the caller must guarantee it is no longer in use)
+			vkDestroyShaderModule(device, it->second.module, nullptr);
+			modules.erase(it);
+		}
+
+		CachedModule cached;
+		cached.module = createModuleFromFile(device, path);
+		cached.mtime = mtime;
+		modules[path] = cached;
+
+		return cached.module;
+	}
+
+	/// <summary>
+	/// Reads the given SPIR-V files into memory ahead of time. Meant to
+	/// run on a worker thread during startup, overlapping the file IO
+	/// with instance/window creation; createModuleFromFile consumes the
+	/// prefetched bytes instead of touching the filesystem. Must finish
+	/// before the first getModule call (no internal locking).
+	/// </summary>
+	/// <param name="paths">Paths to the .spv files.</param>
+	static void prefetch(const std::vector<std::string>& paths) {
+		for (const std::string& path : paths) {
+			try {
+				PrefetchedFile file;
+				file.bytes = readFile(path);
+				file.mtime = std::filesystem::last_write_time(path);
+				prefetched()[path] = std::move(file);
+			}
+			catch (const std::exception&) {
+				// missing file: not fatal here - the regular load path
+				// will produce the proper error if the file is needed
+			}
+		}
+	}
+
+	/// <summary>
+	/// Destroys all cached shader modules. Called once at shutdown,
+	/// before the device is destroyed.
+	/// </summary>
+	/// <param name="device">The device.</param>
+	static void destroyModules(VkDevice device) {
+		for (auto& entry : cache()) {
+			vkDestroyShaderModule(device, entry.second.module, nullptr);
+		}
+		cache().clear();
+	}
+
 
 	/// <summary>
 	/// Initializes a new instance of the <see cref="Shader" /> class.
@@ -68,7 +150,87 @@ public:
 		vkDestroyShaderModule(device, vertShaderModule, nullptr);
 	};
 private:
-	
+
+	/* one cache entry: the module plus the mtime of the file it was built from */
+	struct CachedModule {
+		VkShaderModule module = VK_NULL_HANDLE;
+		std::filesystem::file_time_type mtime;
+	};
+
+	/* path -> module cache (lazy singleton, header-only friendly) */
+	static std::unordered_map<std::string, CachedModule>& cache() {
+		static std::unordered_map<std::string, CachedModule> modules;
+		return modules;
+	}
+
+	/* bytes read ahead of time by prefetch(), consumed once on first load */
+	struct PrefetchedFile {
+		std::vector<char> bytes;
+		std::filesystem::file_time_type mtime;
+	};
+
+	static std::unordered_map<std::string, PrefetchedFile>& prefetched() {
+		static std::unordered_map<std::string, PrefetchedFile> files;
+		return files;
+	}
+
+	/// <summary>
+	/// Loads a SPIR-V file and creates a shader module from it. On POSIX
+	/// platforms the file is memory-mapped (zero-copy; mappings are page
+	/// aligned, which satisfies the 4-byte alignment vkCreateShaderModule
+	/// requires) and unmapped right after module creation. Elsewhere it
+	/// falls back to the ifstream read path.
+	/// </summary>
+	/// <param name="device">The device.</param>
+	/// <param name="path">Path to the .spv file.</param>
+	/// <returns></returns>
+	static VkShaderModule createModuleFromFile(VkDevice device, const std::string& path) {
+		// prefetched during startup? consume the bytes and skip the IO
+		// (only if the file has not changed since the prefetch)
+		auto pre = prefetched().find(path);
+		if (pre != prefetched().end()) {
+			if (pre->second.mtime == std::filesystem::last_write_time(path)) {
+				VkShaderModule module = createShaderModule(device, pre->second.bytes);
+				prefetched().erase(pre);
+				return module;
+			}
+			prefetched().erase(pre);
+		}
+
+#ifdef SHADER_HAS_MMAP
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd >= 0) {
+			struct stat fileInfo;
+			if (fstat(fd, &fileInfo) == 0 && fileInfo.st_size > 0) {
+				void* data = mmap(nullptr, fileInfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				// the mapping stays valid after closing the descriptor
+				close(fd);
+				if (data != MAP_FAILED) {
+					VkShaderModuleCreateInfo createInfo = {};
+					createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+					createInfo.codeSize = (size_t)fileInfo.st_size;
+					createInfo.pCode = reinterpret_cast<const uint32_t*>(data);
+
+					VkShaderModule shaderModule;
+					VkResult result = vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule);
+					// the driver copied the code - the mapping can go
+					munmap(data, fileInfo.st_size);
+
+					if (result != VK_SUCCESS) {
+						throw std::runtime_error("failed to create shader module!");
+					}
+					return shaderModule;
+				}
+			}
+			else {
+				close(fd);
+			}
+		}
+		// fall through to the read path on any mapping failure
+#endif
+		std::vector<char> code = readFile(path);
+		return createShaderModule(device, code);
+	}
 
 	/// <summary>
 	/// Creates a VkShaderModule Object.
@@ -76,7 +238,7 @@ private:
 	/// <param name="device">The device.</param>
 	/// <param name="code">The buffer with the bytecode.</param>
 	/// <returns></returns>
-	VkShaderModule createShaderModule(VkDevice device, const std::vector<char>& code) {
+	static VkShaderModule createShaderModule(VkDevice device, const std::vector<char>& code) {
 		VkShaderModuleCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 		// size spezified in bytes
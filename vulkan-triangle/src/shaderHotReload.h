@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Shader hot reload: lets the shaders be edited while the app runs,
+ * without a restart (a restart costs the full init sequence - far too
+ * slow for lookdev iteration).
+ *
+ * A worker thread polls the modification times of the GLSL sources and
+ * of the compiled SPIR-V files. When a source changes it is recompiled
+ * through the SDK's glslc - the same compiler the offline
+ * compileShader scripts run - and when fresh SPIR-V appears (from the
+ * recompile or written externally, e.g. by the artist's own script)
+ * the owner's rebuild callback is invoked ON THE WORKER THREAD. The
+ * expensive pipeline build therefore never runs on the render thread;
+ * the owner only publishes the result and swaps it in at the next
+ * frame boundary.
+ *
+ * A failed compile or pipeline build is reported to stderr and the
+ * previous pipeline keeps rendering - a typo in a shader must never
+ * take the app down mid-iteration.
+ */
+class ShaderHotReload {
+public:
+
+	/* one watched shader: the GLSL source and the SPIR-V it compiles to */
+	struct ShaderPair {
+		std::string source;
+		std::string compiled;
+	};
+
+	/* how often the worker polls the file modification times */
+	static const uint32_t POLL_INTERVAL_MS = 500;
+
+	/**
+	 * Starts the watcher thread
+	 * @param shaders			the shader files to watch
+	 * @param rebuildPipeline	builds the replacement pipeline from the
+	 *							changed SPIR-V; runs on the worker thread
+	 */
+	void init(const std::vector<ShaderPair>& shaders,
+			std::function<void()> rebuildPipeline) {
+		this->rebuildPipeline = rebuildPipeline;
+
+		// stamp the current state so startup never triggers a rebuild
+		for (const ShaderPair& pair : shaders) {
+			WatchedShader shader;
+			shader.files = pair;
+			shader.sourceMtime = mtimeOf(pair.source);
+			shader.compiledMtime = mtimeOf(pair.compiled);
+			watched.push_back(shader);
+		}
+
+		running = true;
+		watcher = std::thread(&ShaderHotReload::watchLoop, this);
+	}
+
+	/**
+	 * Stops the watcher thread. Call before tearing down anything the
+	 * rebuild callback touches (device, pipeline cache, shader cache)
+	 */
+	void destroy() {
+		if (!watcher.joinable()) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			running = false;
+		}
+		wakeCondition.notify_one();
+		watcher.join();
+		watched.clear();
+	}
+
+private:
+
+	/* one watched shader plus the last seen modification times */
+	struct WatchedShader {
+		ShaderPair files;
+		std::filesystem::file_time_type sourceMtime;
+		std::filesystem::file_time_type compiledMtime;
+	};
+
+	void watchLoop() {
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(wakeMutex);
+				wakeCondition.wait_for(lock,
+					std::chrono::milliseconds(POLL_INTERVAL_MS),
+					[this] { return !running; });
+				if (!running) {
+					return;
+				}
+			}
+
+			bool spirvChanged = false;
+			for (WatchedShader& shader : watched) {
+				// a changed source is recompiled right here on the worker;
+				// the fresh SPIR-V is then picked up below like any other
+				auto sourceMtime = mtimeOf(shader.files.source);
+				if (sourceMtime != shader.sourceMtime &&
+						sourceMtime != std::filesystem::file_time_type::min()) {
+					shader.sourceMtime = sourceMtime;
+					compile(shader.files);
+				}
+
+				auto compiledMtime = mtimeOf(shader.files.compiled);
+				if (compiledMtime != shader.compiledMtime &&
+						compiledMtime != std::filesystem::file_time_type::min()) {
+					shader.compiledMtime = compiledMtime;
+					spirvChanged = true;
+				}
+			}
+
+			if (!spirvChanged) {
+				continue;
+			}
+
+			// an external compile may still be writing the file - give it a
+			// moment to finish, then stamp what we are actually loading
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			for (WatchedShader& shader : watched) {
+				shader.compiledMtime = mtimeOf(shader.files.compiled);
+			}
+
+			try {
+				rebuildPipeline();
+			}
+			catch (const std::exception& e) {
+				// broken SPIR-V (e.g. a half-saved file): keep rendering
+				// with the previous pipeline
+				std::cerr << "shader hot reload: pipeline rebuild failed: "
+					<< e.what() << std::endl;
+			}
+		}
+	}
+
+	/**
+	 * Compiles one shader source to SPIR-V through glslc, resolved from
+	 * VULKAN_SDK like the offline compileShader scripts do (falls back
+	 * to the PATH). glslc prints its own diagnostics, so a failure only
+	 * needs a one-line note here
+	 */
+	static bool compile(const ShaderPair& shader) {
+		std::string glslc = "glslc";
+		if (const char* sdk = std::getenv("VULKAN_SDK")) {
+			glslc = std::string(sdk) + "/bin/glslc";
+		}
+
+		std::string command = "\"" + glslc + "\" \"" + shader.source
+			+ "\" -o \"" + shader.compiled + "\"";
+
+		if (std::system(command.c_str()) != 0) {
+			std::cerr << "shader hot reload: compile failed for "
+				<< shader.source << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	/* modification time, or min() if the file is (transiently) missing -
+	 * editors replace files on save, so a miss is not an error */
+	static std::filesystem::file_time_type mtimeOf(const std::string& path) {
+		std::error_code error;
+		auto mtime = std::filesystem::last_write_time(path, error);
+		if (error) {
+			return std::filesystem::file_time_type::min();
+		}
+		return mtime;
+	}
+
+	std::vector<WatchedShader> watched;
+	std::function<void()> rebuildPipeline;
+
+	std::thread watcher;
+	bool running = false;
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+};
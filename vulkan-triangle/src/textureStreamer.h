@@ -0,0 +1,594 @@
+#pragma once
+
+//Include Vulkan
+#include <vulkan/vulkan.h>
+
+// stb_image for decoding (STB_IMAGE_IMPLEMENTATION lives in exactly one
+// translation unit - TriangleApplication.cpp)
+#include <stb_image.h>
+
+#include "bufferAllocator.h"
+#include "queueTimeline.h"
+
+#include <vector>
+#include <string>
+#include <queue>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <iostream>
+#include <cstring>
+#include <cmath>
+
+/**
+ * Streaming texture loader.
+ *
+ * Blocking texture loads are the biggest hitch source in a renderer, so
+ * every stage of a load happens off the frame's critical path:
+ *  - a dedicated IO thread reads and decodes the files (stb_image)
+ *  - uploads go out on the transfer queue (overlapping rendering on
+ *    devices with a dedicated transfer family), with the mip chain
+ *    generated on the graphics queue via vkCmdBlitImage; the two
+ *    submissions are chained through the queue timelines (the blit
+ *    submit waits on the copy's timeline value) and completion is
+ *    polled - never waited on - from update(). No per-upload semaphore
+ *    or fence objects exist
+ *  - resident textures are tracked against a VRAM budget; when it is
+ *    exceeded, the least recently used textures are evicted and their
+ *    memory returned to the pool allocator
+ *
+ * update() must be called once per frame from the render thread; it
+ * turns decoded pixels into upload submissions, retires finished
+ * uploads and runs the eviction pass. request() may be called any time
+ * and returns a handle immediately - isResident() tells when the
+ * texture can actually be sampled.
+ */
+class TextureStreamer {
+public:
+
+	/* handle value meaning "no texture" */
+	static const uint32_t INVALID_HANDLE = UINT32_MAX;
+
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, BufferAllocator* allocator,
+			VkQueue transferQueue, uint32_t transferFamily,
+			VkQueue graphicsQueue, uint32_t graphicsFamily,
+			QueueTimeline* transferTimeline, QueueTimeline* graphicsTimeline,
+			VkDeviceSize budgetBytes) {
+		this->device = device;
+		this->allocator = allocator;
+		this->transferQueue = transferQueue;
+		this->transferFamily = transferFamily;
+		this->graphicsQueue = graphicsQueue;
+		this->graphicsFamily = graphicsFamily;
+		this->transferTimeline = transferTimeline;
+		this->graphicsTimeline = graphicsTimeline;
+		this->budgetBytes = budgetBytes;
+
+		// transient pools: every upload allocates, submits and frees
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = transferFamily;
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &transferPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create texture transfer pool!");
+		}
+		poolInfo.queueFamilyIndex = graphicsFamily;
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &graphicsPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create texture graphics pool!");
+		}
+
+		running = true;
+		ioThread = std::thread(&TextureStreamer::ioLoop, this);
+	}
+
+	/**
+	 * Requests a texture. Returns a handle immediately; the IO thread
+	 * picks the file up in the background. Requesting the same path
+	 * again returns the existing handle (and revives an evicted texture)
+	 * @param path	image file readable by stb_image
+	 */
+	uint32_t request(const std::string& path) {
+		for (uint32_t i = 0; i < (uint32_t)textures.size(); i++) {
+			if (textures[i].path == path) {
+				if (textures[i].state == State::EVICTED) {
+					textures[i].state = State::LOADING;
+					enqueueLoad(i);
+				}
+				return i;
+			}
+		}
+
+		Texture texture;
+		texture.path = path;
+		texture.state = State::LOADING;
+		textures.push_back(texture);
+
+		uint32_t handle = (uint32_t)textures.size() - 1;
+		enqueueLoad(handle);
+		return handle;
+	}
+
+	/* whether the texture is uploaded and safe to sample */
+	bool isResident(uint32_t handle) const {
+		return handle < textures.size() && textures[handle].state == State::RESIDENT;
+	}
+
+	/**
+	 * Returns the image view of a resident texture and marks it as used
+	 * this frame (for the LRU eviction); VK_NULL_HANDLE while streaming
+	 * @param handle
+	 */
+	VkImageView getView(uint32_t handle) {
+		if (!isResident(handle)) {
+			return VK_NULL_HANDLE;
+		}
+		textures[handle].lastUseFrame = frameCounter;
+		return textures[handle].view;
+	}
+
+	/**
+	 * Per-frame tick (render thread): starts uploads for freshly decoded
+	 * images, retires finished uploads, evicts over budget. Completion
+	 * checks are timeline polls - this never blocks
+	 */
+	void update() {
+		frameCounter++;
+
+		// decoded -> upload in flight
+		std::vector<DecodedImage> decoded;
+		{
+			std::lock_guard<std::mutex> lock(decodedMutex);
+			decoded.swap(decodedImages);
+		}
+		for (DecodedImage& image : decoded) {
+			beginUpload(image);
+		}
+
+		// poll the in-flight uploads against the graphics timeline (one
+		// driver query covers every upload)
+		if (!uploads.empty()) {
+			uint64_t completed = graphicsTimeline->completedValue();
+			for (size_t i = 0; i < uploads.size();) {
+				if (completed >= uploads[i].doneValue) {
+					finishUpload(uploads[i]);
+					uploads.erase(uploads.begin() + i);
+				}
+				else {
+					i++;
+				}
+			}
+		}
+
+		evictOverBudget();
+	}
+
+	void destroy() {
+		// stop the IO thread first
+		{
+			std::lock_guard<std::mutex> lock(requestMutex);
+			running = false;
+		}
+		requestCondition.notify_all();
+		if (ioThread.joinable()) {
+			ioThread.join();
+		}
+
+		// drain in-flight uploads (shutdown - blocking is fine here)
+		for (Upload& upload : uploads) {
+			graphicsTimeline->hostWait(upload.doneValue);
+			finishUpload(upload);
+		}
+		uploads.clear();
+
+		// free any decoded-but-never-uploaded pixels
+		for (DecodedImage& image : decodedImages) {
+			stbi_image_free(image.pixels);
+		}
+
+		for (Texture& texture : textures) {
+			if (texture.state == State::RESIDENT) {
+				evict(texture);
+			}
+		}
+		textures.clear();
+
+		vkDestroyCommandPool(device, transferPool, nullptr);
+		vkDestroyCommandPool(device, graphicsPool, nullptr);
+	}
+
+	/* bytes currently resident (for instrumentation) */
+	VkDeviceSize residentBytes() const { return residentSize; }
+
+private:
+
+	enum class State { LOADING, RESIDENT, EVICTED };
+
+	struct Texture {
+		std::string path;
+		State state = State::LOADING;
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		BufferAllocator::Allocation allocation;
+		uint32_t mipLevels = 1;
+		VkDeviceSize size = 0;
+		uint64_t lastUseFrame = 0;
+	};
+
+	/* pixels handed over from the IO thread */
+	struct DecodedImage {
+		uint32_t handle = 0;
+		stbi_uc* pixels = nullptr;
+		int width = 0;
+		int height = 0;
+	};
+
+	/* one upload in flight on the GPU */
+	struct Upload {
+		uint32_t handle = 0;
+		VkBuffer staging = VK_NULL_HANDLE;
+		BufferAllocator::Allocation stagingAllocation;
+		VkCommandBuffer transferCommands = VK_NULL_HANDLE;
+		VkCommandBuffer graphicsCommands = VK_NULL_HANDLE;
+		/* transfer timeline value the copy signals (the blits wait on it) */
+		uint64_t copyValue = 0;
+		/* graphics timeline value the blits signal (completion marker) */
+		uint64_t doneValue = 0;
+	};
+
+	void enqueueLoad(uint32_t handle) {
+		{
+			std::lock_guard<std::mutex> lock(requestMutex);
+			// the path travels by value: the textures vector belongs to the
+			// render thread, and a request() growing it would invalidate
+			// any reference the IO thread holds into it
+			loadRequests.push(std::make_pair(handle, textures[handle].path));
+		}
+		requestCondition.notify_one();
+	}
+
+	/* the IO thread: file reads and decoding, nothing Vulkan */
+	void ioLoop() {
+		for (;;) {
+			uint32_t handle;
+			std::string path;
+			{
+				std::unique_lock<std::mutex> lock(requestMutex);
+				requestCondition.wait(lock, [this] { return !running || !loadRequests.empty(); });
+				if (!running) {
+					return;
+				}
+				handle = loadRequests.front().first;
+				path = loadRequests.front().second;
+				loadRequests.pop();
+			}
+
+			DecodedImage image;
+			image.handle = handle;
+			int channels;
+			// force RGBA - matches VK_FORMAT_R8G8B8A8_SRGB
+			image.pixels = stbi_load(path.c_str(),
+				&image.width, &image.height, &channels, STBI_rgb_alpha);
+			if (image.pixels == nullptr) {
+				// missing/corrupt file: leave the texture non-resident
+				// (the renderer keeps using its fallback)
+				std::cerr << "texture streamer: failed to load "
+					<< path << std::endl;
+				continue;
+			}
+
+			std::lock_guard<std::mutex> lock(decodedMutex);
+			decodedImages.push_back(image);
+		}
+	}
+
+	/* render thread: decoded pixels -> staging copy + mip blits on the GPU */
+	void beginUpload(DecodedImage& decoded) {
+		Texture& texture = textures[decoded.handle];
+		VkDeviceSize imageSize = (VkDeviceSize)decoded.width * decoded.height * 4;
+
+		// full mip chain down to 1x1
+		texture.mipLevels = (uint32_t)std::floor(std::log2(std::max(decoded.width, decoded.height))) + 1;
+
+		// staging buffer (persistently mapped block - plain memcpy)
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = imageSize;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		Upload upload;
+		upload.handle = decoded.handle;
+		if (vkCreateBuffer(device, &bufferInfo, nullptr, &upload.staging) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create texture staging buffer!");
+		}
+		VkMemoryRequirements stagingRequirements;
+		vkGetBufferMemoryRequirements(device, upload.staging, &stagingRequirements);
+		upload.stagingAllocation = allocator->allocate(stagingRequirements,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+		vkBindBufferMemory(device, upload.staging, upload.stagingAllocation.memory, upload.stagingAllocation.offset);
+
+		memcpy(upload.stagingAllocation.mapped, decoded.pixels, (size_t)imageSize);
+		stbi_image_free(decoded.pixels);
+
+		// the image itself: sampled + transfer dst (copy) + transfer src
+		// (the blits read the previous mip level)
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent = { (uint32_t)decoded.width, (uint32_t)decoded.height, 1 };
+		imageInfo.mipLevels = texture.mipLevels;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		// concurrent between the transfer and graphics families skips the
+		// queue family ownership transfer barriers
+		uint32_t families[] = { graphicsFamily, transferFamily };
+		if (graphicsFamily != transferFamily) {
+			imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			imageInfo.queueFamilyIndexCount = 2;
+			imageInfo.pQueueFamilyIndices = families;
+		}
+		else {
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		}
+
+		if (vkCreateImage(device, &imageInfo, nullptr, &texture.image) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create texture image!");
+		}
+		VkMemoryRequirements imageRequirements;
+		vkGetImageMemoryRequirements(device, texture.image, &imageRequirements);
+		texture.allocation = allocator->allocate(imageRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
+		vkBindImageMemory(device, texture.image, texture.allocation.memory, texture.allocation.offset);
+		texture.size = imageRequirements.size;
+
+		// transfer queue: layout to TRANSFER_DST, copy mip 0
+		upload.transferCommands = beginCommands(transferPool);
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = texture.image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mipLevels, 0, 1 };
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(upload.transferCommands,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkBufferImageCopy region{};
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageExtent = { (uint32_t)decoded.width, (uint32_t)decoded.height, 1 };
+		vkCmdCopyBufferToImage(upload.transferCommands, upload.staging, texture.image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		if (vkEndCommandBuffer(upload.transferCommands) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record texture copy!");
+		}
+
+		// graphics queue: generate the mip chain with blits, finish with
+		// SHADER_READ_ONLY on every level
+		upload.graphicsCommands = beginCommands(graphicsPool);
+		recordMipChain(upload.graphicsCommands, texture, decoded.width, decoded.height);
+		if (vkEndCommandBuffer(upload.graphicsCommands) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record mip generation!");
+		}
+
+		// chain the two submissions through the queue timelines:
+		// copy signals transfer=copyValue -> blits wait on it and signal
+		// graphics=doneValue, which update() polls. No objects to create
+		upload.copyValue = transferTimeline->nextValue();
+		upload.doneValue = graphicsTimeline->nextValue();
+
+		VkTimelineSemaphoreSubmitInfoKHR copyTimelineInfo{};
+		copyTimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		copyTimelineInfo.signalSemaphoreValueCount = 1;
+		copyTimelineInfo.pSignalSemaphoreValues = &upload.copyValue;
+
+		VkSemaphore transferSemaphore = transferTimeline->handle();
+		VkSemaphore graphicsSemaphore = graphicsTimeline->handle();
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &copyTimelineInfo;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &upload.transferCommands;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &transferSemaphore;
+		if (vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit texture copy!");
+		}
+
+		VkTimelineSemaphoreSubmitInfoKHR blitTimelineInfo{};
+		blitTimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		blitTimelineInfo.waitSemaphoreValueCount = 1;
+		blitTimelineInfo.pWaitSemaphoreValues = &upload.copyValue;
+		blitTimelineInfo.signalSemaphoreValueCount = 1;
+		blitTimelineInfo.pSignalSemaphoreValues = &upload.doneValue;
+
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		submitInfo.pNext = &blitTimelineInfo;
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = &transferSemaphore;
+		submitInfo.pWaitDstStageMask = &waitStage;
+		submitInfo.pCommandBuffers = &upload.graphicsCommands;
+		submitInfo.pSignalSemaphores = &graphicsSemaphore;
+		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit mip generation!");
+		}
+
+		uploads.push_back(upload);
+	}
+
+	/* blit each mip level from the previous one, leave all levels SHADER_READ_ONLY */
+	void recordMipChain(VkCommandBuffer commands, Texture& texture, int width, int height) {
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.image = texture.image;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		int mipWidth = width;
+		int mipHeight = height;
+
+		for (uint32_t level = 1; level < texture.mipLevels; level++) {
+			// previous level: TRANSFER_DST -> TRANSFER_SRC for the blit read
+			barrier.subresourceRange.baseMipLevel = level - 1;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			vkCmdPipelineBarrier(commands,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+				0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+			VkImageBlit blit{};
+			blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+			blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+			blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
+			blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+			vkCmdBlitImage(commands,
+				texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &blit, VK_FILTER_LINEAR);
+
+			// previous level is final - hand it to the shaders
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(commands,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+			if (mipWidth > 1) mipWidth /= 2;
+			if (mipHeight > 1) mipHeight /= 2;
+		}
+
+		// the last level was only ever written
+		barrier.subresourceRange.baseMipLevel = texture.mipLevels - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commands,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	/* the timeline passed doneValue: create the view, release the upload
+	 * scaffolding */
+	void finishUpload(Upload& upload) {
+		Texture& texture = textures[upload.handle];
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = texture.image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mipLevels, 0, 1 };
+		if (vkCreateImageView(device, &viewInfo, nullptr, &texture.view) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create texture image view!");
+		}
+
+		texture.state = State::RESIDENT;
+		texture.lastUseFrame = frameCounter;
+		residentSize += texture.size;
+
+		vkDestroyBuffer(device, upload.staging, nullptr);
+		allocator->free(upload.stagingAllocation);
+		vkFreeCommandBuffers(device, transferPool, 1, &upload.transferCommands);
+		vkFreeCommandBuffers(device, graphicsPool, 1, &upload.graphicsCommands);
+	}
+
+	/* LRU pass: drop the least recently used textures until under budget */
+	void evictOverBudget() {
+		while (residentSize > budgetBytes) {
+			Texture* victim = nullptr;
+			for (Texture& texture : textures) {
+				// textures used in the last few frames may still be
+				// referenced by frames in flight - never evict those
+				if (texture.state != State::RESIDENT ||
+					texture.lastUseFrame + 3 > frameCounter) {
+					continue;
+				}
+				if (victim == nullptr || texture.lastUseFrame < victim->lastUseFrame) {
+					victim = &texture;
+				}
+			}
+			if (victim == nullptr) {
+				// everything left is in use - over budget until demand drops
+				break;
+			}
+			evict(*victim);
+		}
+	}
+
+	void evict(Texture& texture) {
+		vkDestroyImageView(device, texture.view, nullptr);
+		vkDestroyImage(device, texture.image, nullptr);
+		allocator->free(texture.allocation);
+		texture.view = VK_NULL_HANDLE;
+		texture.image = VK_NULL_HANDLE;
+		residentSize -= texture.size;
+		texture.state = State::EVICTED;
+	}
+
+	VkCommandBuffer beginCommands(VkCommandPool pool) {
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = pool;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+		return commandBuffer;
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	BufferAllocator* allocator = nullptr;
+	VkQueue transferQueue = VK_NULL_HANDLE;
+	uint32_t transferFamily = 0;
+	VkQueue graphicsQueue = VK_NULL_HANDLE;
+	uint32_t graphicsFamily = 0;
+	/* the owner's per-queue timelines (see queueTimeline.h) - uploads
+	 * reserve their values on the render thread, interleaved with the
+	 * frame submits, so all signals stay monotonic per queue */
+	QueueTimeline* transferTimeline = nullptr;
+	QueueTimeline* graphicsTimeline = nullptr;
+	VkCommandPool transferPool = VK_NULL_HANDLE;
+	VkCommandPool graphicsPool = VK_NULL_HANDLE;
+
+	VkDeviceSize budgetBytes = 0;
+	VkDeviceSize residentSize = 0;
+	uint64_t frameCounter = 0;
+
+	std::vector<Texture> textures;
+	std::vector<Upload> uploads;
+
+	/* IO thread plumbing */
+	std::thread ioThread;
+	bool running = false;
+	std::mutex requestMutex;
+	std::condition_variable requestCondition;
+	/* handle plus a copy of the path - the IO thread must not read the
+	 * textures vector (see enqueueLoad) */
+	std::queue<std::pair<uint32_t, std::string>> loadRequests;
+	std::mutex decodedMutex;
+	std::vector<DecodedImage> decodedImages;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Lock-free single-producer/single-consumer queue for window events.
+ *
+ * The main thread owns GLFW and pumps its events continuously; the
+ * render thread runs drawFrame(). The GLFW callbacks (producer) push
+ * small event records here and the render thread (consumer) drains
+ * them at the top of every frame - neither side ever takes a lock, so
+ * a render thread blocked in a timeline wait or an acquire can never
+ * delay event processing and vice versa.
+ *
+ * The ring is fixed-size; head and tail are monotonically increasing
+ * counters and only ever written by their own side, which is all the
+ * synchronization a SPSC queue needs. If the ring ever fills (the
+ * render thread would have to stall for hundreds of resize events),
+ * push() drops the event - harmless for resizes, because an out-of-date
+ * swap chain is caught at present time anyway.
+ */
+class WindowEventQueue {
+public:
+
+	enum class Type {
+		FRAMEBUFFER_RESIZED,
+	};
+
+	/* one queued event; windowIndex 0 is the first window, 1..N-1 are
+	 * extraWindows[windowIndex - 1] */
+	struct Event {
+		Type type = Type::FRAMEBUFFER_RESIZED;
+		uint32_t windowIndex = 0;
+		int width = 0;
+		int height = 0;
+	};
+
+	/* ring capacity (power of two so the index wrap is a mask) */
+	static const size_t CAPACITY = 256;
+
+	/**
+	 * Enqueues an event (main thread only). Returns false if the ring
+	 * is full and the event was dropped
+	 */
+	bool push(const Event& event) {
+		size_t currentTail = tail.load(std::memory_order_relaxed);
+		if (currentTail - head.load(std::memory_order_acquire) >= CAPACITY) {
+			return false;
+		}
+		events[currentTail & (CAPACITY - 1)] = event;
+		// the release pairs with the consumer's acquire: the event data
+		// is fully written before the new tail becomes visible
+		tail.store(currentTail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Dequeues the oldest event (render thread only). Returns false
+	 * when the queue is empty
+	 */
+	bool pop(Event& event) {
+		size_t currentHead = head.load(std::memory_order_relaxed);
+		if (currentHead == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		event = events[currentHead & (CAPACITY - 1)];
+		head.store(currentHead + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+
+	Event events[CAPACITY];
+
+	/* monotonic counters; head is written by the consumer only, tail by
+	 * the producer only */
+	std::atomic<size_t> head{ 0 };
+	std::atomic<size_t> tail{ 0 };
+};